@@ -4,6 +4,7 @@
 #include <eosio/eosio.hpp>
 
 #include <string>
+#include <vector>
 
 namespace celesossystem {
    class system_contract;
@@ -38,6 +39,17 @@ namespace celes {
       public:
          using contract::contract;
 
+         /**
+          * One credit of a `transfermany` action.
+          */
+         struct transfer_entry {
+            name     to;
+            int64_t  amount;
+            string   memo;
+
+            EOSLIB_SERIALIZE( transfer_entry, (to)(amount)(memo) )
+         };
+
          /**
           * Create action.
           *
@@ -95,6 +107,29 @@ namespace celes {
                         const name&    to,
                         const asset&   quantity,
                         const string&  memo );
+
+         /**
+          * Transfer many action.
+          *
+          * @details Allows `from` account to transfer `sym` tokens to every account of `transfers`.
+          * `from` is debited once with the total, each `to` is credited with its `amount`.
+          * `from` is always notified. When `notify` is set every `to` is notified too, of this action
+          * rather than of a `transfer`, so contracts that only handle `transfer` notifications do not
+          * see these credits. When it is not set no `to` is notified at all.
+          *
+          * @param from - the account to transfer from,
+          * @param sym - the symbol of the tokens to be transferred,
+          * @param transfers - the accounts to be transferred to, with the amount and memo of each,
+          * @param notify - whether each `to` account is notified.
+          *
+          * @pre Every `to` account must exist and differ from `from`,
+          * @pre Every amount must be positive and every memo at most 256 bytes long.
+          */
+         [[eosio::action]]
+         void transfermany( const name&                         from,
+                            const symbol&                       sym,
+                            const std::vector<transfer_entry>&  transfers,
+                            bool                                notify );
          /**
           * Open action.
           *
@@ -162,6 +197,7 @@ namespace celes {
          using issue_action = eosio::action_wrapper<"issue"_n, &token::issue>;
          using retire_action = eosio::action_wrapper<"retire"_n, &token::retire>;
          using transfer_action = eosio::action_wrapper<"transfer"_n, &token::transfer>;
+         using transfermany_action = eosio::action_wrapper<"transfermany"_n, &token::transfermany>;
          using open_action = eosio::action_wrapper<"open"_n, &token::open>;
          using close_action = eosio::action_wrapper<"close"_n, &token::close>;
       private:
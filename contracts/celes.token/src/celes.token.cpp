@@ -100,6 +100,39 @@ void token::transfer( const name&    from,
     add_balance( to, quantity, payer );
 }
 
+void token::transfermany( const name&                         from,
+                          const symbol&                       sym,
+                          const std::vector<transfer_entry>&  transfers,
+                          bool                                notify )
+{
+    require_auth( from );
+    check( !transfers.empty(), "no transfers" );
+    stats statstable( get_self(), sym.code().raw() );
+    const auto& st = statstable.get( sym.code().raw() );
+    check( sym == st.supply.symbol, "symbol precision mismatch" );
+
+    require_recipient( from );
+
+    asset total( 0, sym );
+    for( const auto& t : transfers ) {
+       const asset quantity( t.amount, sym );
+       check( from != t.to, "cannot transfer to self" );
+       check( is_account( t.to ), "to account does not exist");
+       check( quantity.is_valid(), "invalid quantity" );
+       check( quantity.amount > 0, "must transfer positive quantity" );
+       check( t.memo.size() <= 256, "memo has more than 256 bytes" );
+
+       if( notify ) {
+          require_recipient( t.to );
+       }
+
+       add_balance( t.to, quantity, has_auth( t.to ) ? t.to : from );
+       total += quantity;
+    }
+
+    sub_balance( from, total );
+}
+
 void token::sub_balance( const name& owner, const asset& value ) {
    accounts from_acnts( get_self(), owner.value );
 
@@ -7,8 +7,6 @@ namespace celesos
 using eosio::asset;
 using eosio::symbol;
 
-typedef double real_type;
-
 /**
     *  Uses Bancor math to create a 50/50 relay between two asset types. The state of the
     *  bancor exchange is entirely contained within this struct. There are no external
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstdint>
+
+namespace celesossystem {
+
+   /**
+    * @addtogroup celesossystem
+    * @{
+    */
+
+   /**
+    * Fixed-point Bancor kernel shared by `exchange_state`, REX and contracts quoting the `rammarket` table.
+    *
+    * @details Ratios are unsigned Q64.64 numbers and logarithms signed Q64.64 numbers, so every
+    * conversion is computed with integer operations only and quotes the same amount on every node and
+    * in every contract including this header. It depends on nothing but the compiler's 128-bit integers.
+    */
+   namespace bancor {
+
+      typedef unsigned __int128 ufixed; ///< unsigned Q64.64
+      typedef __int128          sfixed; ///< signed Q64.64
+
+      static constexpr uint32_t frac_bits = 64;
+      static constexpr ufixed   one       = ufixed(1) << frac_bits;
+
+      /// Fixed-point weights are Q32.32, exact for the connector weights of the form m / 2^k in use.
+      static constexpr uint32_t weight_bits = 32;
+
+      constexpr uint64_t isqrt( ufixed x ) {
+         ufixed root = 0;
+         for( ufixed bit = ufixed(1) << 126; bit != 0; bit >>= 2 ) {
+            if( x >= root + bit ) {
+               x   -= root + bit;
+               root = (root >> 1) + bit;
+            } else {
+               root >>= 1;
+            }
+         }
+         return uint64_t(root);
+      }
+
+      /// `roots[i]` is 2^(2^-(i + 1)) in Q1.63, from repeated integer square roots of 2
+      struct exp2_roots {
+         uint64_t values[64] = {};
+
+         constexpr exp2_roots() {
+            ufixed root = ufixed(2) << 63;
+            for( uint32_t i = 0; i < 64; ++i ) {
+               values[i] = isqrt( root << 63 );
+               root = values[i];
+            }
+         }
+      };
+
+      static constexpr exp2_roots roots{};
+
+      constexpr uint32_t msb( ufixed x ) {
+         const uint64_t high = uint64_t(x >> 64);
+         return high != 0 ? 127 - __builtin_clzll( high ) : 63 - __builtin_clzll( uint64_t(x) );
+      }
+
+      /**
+       * Base 2 logarithm of the Q64.64 number `x`.
+       *
+       * @details The fraction is produced bit by bit by squaring the Q1.63 mantissa. The result is
+       * below the exact logarithm by less than 2^-61.
+       *
+       * @pre `x` is positive
+       */
+      constexpr sfixed log2( ufixed x ) {
+         const uint32_t top = msb( x );
+         sfixed result = sfixed(int32_t(top) - int32_t(frac_bits)) * sfixed(one);
+
+         uint64_t mantissa = top >= 63 ? uint64_t(x >> (top - 63)) : uint64_t(x << (63 - top));
+         for( int32_t bit = frac_bits - 1; bit >= 0; --bit ) {
+            const ufixed square = ufixed(mantissa) * mantissa;
+            if( square >> 127 ) {
+               mantissa = uint64_t(square >> 64);
+               result  += sfixed(1) << bit;
+            } else {
+               mantissa = uint64_t(square >> 63);
+            }
+         }
+         return result;
+      }
+
+      /**
+       * 2 raised to the signed Q64.64 power `y`, as a Q64.64 number.
+       *
+       * @details The fraction is the product of the roots selected by its bits. Results below 2^-64
+       * are 0, the relative error is below 2^-56.
+       *
+       * @pre `y` is below 63
+       */
+      constexpr ufixed exp2( sfixed y ) {
+         const int64_t  whole    = int64_t(y >> frac_bits);
+         const uint64_t fraction = uint64_t(y);
+
+         uint64_t result = uint64_t(1) << 63;
+         for( uint32_t i = 0; i < 64; ++i ) {
+            if( fraction & (uint64_t(1) << (63 - i)) )
+               result = uint64_t( (ufixed(result) * roots.values[i]) >> 63 );
+         }
+
+         const int64_t shift = whole + 1; // result is Q1.63
+         if( shift >= 0 )
+            return ufixed(result) << shift;
+         return shift > -64 ? ufixed(result >> -shift) : 0;
+      }
+
+      /**
+       * Q64.64 number `x` raised to the Q32.32 power `weight`.
+       *
+       * @pre `weight * log2(x)` is below 63
+       */
+      constexpr ufixed pow( ufixed x, uint64_t weight ) {
+         if( x == 0 )
+            return 0;
+         const sfixed exponent = log2( x );
+         // |exponent| < 2^71 and weight < 2^40, the product fits in 127 bits
+         const sfixed scaled = exponent * sfixed(weight);
+         return exp2( scaled >= 0 ? scaled >> weight_bits : -(-scaled >> weight_bits) );
+      }
+
+      /**
+       * Q64.64 number `x` raised to the power `1 / weight`, for the Q32.32 `weight`.
+       *
+       * @details Divides the logarithm by `weight` instead of multiplying it by a rounded inverse,
+       * whose error would be scaled by the whole reserve.
+       *
+       * @pre `x` is at most 1, `weight` is positive
+       */
+      constexpr ufixed pow_inverse( ufixed x, uint64_t weight ) {
+         if( x == 0 )
+            return 0;
+         // 0 >= log2( x ) >= -2^70, shifted it stays within 103 bits
+         const sfixed exponent = log2( x );
+         return exp2( -((-exponent << weight_bits) / sfixed(weight)) );
+      }
+
+      /// Q32.32 weight of a connector weight stored as a double
+      constexpr uint64_t to_weight( double weight ) {
+         return uint64_t( weight * double(uint64_t(1) << weight_bits) );
+      }
+
+      /// `amount` times the Q64.64 number `x`, rounded down
+      constexpr ufixed mul( uint64_t amount, ufixed x ) {
+         return ufixed(amount) * (x >> frac_bits) + ((ufixed(amount) * uint64_t(x)) >> frac_bits);
+      }
+
+      /**
+       * Smart tokens issued for `payment` paid into a connector holding `reserve` of a relay with `supply`.
+       *
+       * @details Computes `supply * ((1 + payment / reserve) ^ weight - 1)` rounded down.
+       *
+       * @pre `supply`, `reserve` and `payment` are non-negative, `reserve` is positive
+       */
+      constexpr int64_t issue( int64_t supply, int64_t reserve, int64_t payment, uint64_t weight ) {
+         const ufixed ratio  = (ufixed(uint64_t(reserve) + uint64_t(payment)) << frac_bits) / uint64_t(reserve);
+         const ufixed growth = pow( ratio, weight );
+         if( growth <= one )
+            return 0;
+         const ufixed issued = mul( uint64_t(supply), growth - one );
+         return issued >> 63 ? INT64_MAX : int64_t(issued);
+      }
+
+      /**
+       * Connector tokens paid out of `reserve` for `tokens` smart tokens taken out of `supply`.
+       *
+       * @details Computes `reserve * (1 - (1 - tokens / supply) ^ (1 / weight))` rounded down.
+       *
+       * @pre `supply` is positive, `tokens` is between 0 and `supply`, `reserve` is non-negative
+       */
+      constexpr int64_t redeem( int64_t supply, int64_t reserve, int64_t tokens, uint64_t weight ) {
+         const ufixed ratio  = (ufixed(uint64_t(supply) - uint64_t(tokens)) << frac_bits) / uint64_t(supply);
+         const ufixed shrink = pow_inverse( ratio, weight );
+         if( shrink >= one )
+            return 0;
+         return int64_t( mul( uint64_t(reserve), one - shrink ) );
+      }
+
+      /**
+       * Tokens paid out of `out_reserve` for `inp` paid into `inp_reserve`, at the constant reserve
+       * product of `exchange_state::direct_convert` and the REX rent.
+       *
+       * @details Computes `inp * out_reserve / (inp_reserve + inp)` rounded down, 0 when it is negative.
+       */
+      constexpr int64_t output( int64_t inp_reserve, int64_t out_reserve, int64_t inp ) {
+         const __int128 denominator = __int128(inp_reserve) + inp;
+         if( denominator <= 0 )
+            return 0;
+         const __int128 out = __int128(inp) * out_reserve / denominator;
+         return out < 0 ? 0 : int64_t(out);
+      }
+
+      /**
+       * Tokens to pay into `inp_reserve` to take `out` out of `out_reserve`, the inverse of `output`.
+       *
+       * @details Computes `inp_reserve * out / (out_reserve - out)` rounded down, 0 when it is negative
+       * or `out` is not below `out_reserve`.
+       */
+      constexpr int64_t input( int64_t out_reserve, int64_t inp_reserve, int64_t out ) {
+         const __int128 denominator = __int128(out_reserve) - out;
+         if( denominator <= 0 )
+            return 0;
+         const __int128 inp = __int128(inp_reserve) * out / denominator;
+         return inp < 0 ? 0 : inp > INT64_MAX ? INT64_MAX : int64_t(inp);
+      }
+
+      static_assert( isqrt( ufixed(1) << 126 ) == uint64_t(1) << 63 );
+      static_assert( log2( one ) == 0 && log2( one << 10 ) == sfixed(one) * 10 && log2( one >> 3 ) == -sfixed(one) * 3 );
+      static_assert( exp2( 0 ) == one && exp2( sfixed(one) * 5 ) == one << 5 && exp2( -sfixed(one) ) == one >> 1 );
+      static_assert( to_weight( .5 ) == uint64_t(1) << 31 );
+      static_assert( issue( 1000000, 1000000, 3000000, to_weight( .5 ) ) == 1000000 );
+      static_assert( redeem( 1000000, 1000000, 500000, to_weight( .5 ) ) == 750000 );
+      static_assert( output( 1000000, 2000000, 1000000 ) == 1000000 && output( 3, 10, 1 ) == 2 );
+      static_assert( input( 2000000, 1000000, 1000000 ) == 1000000 && input( 10, 3, 2 ) == 0 );
+
+   } /// namespace bancor
+
+   /** @}*/ // end of @addtogroup celesossystem
+} /// namespace celesossystem
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <eosio/binary_extension.hpp>
 #include <eosio/privileged.hpp>
 #include <eosio/singleton.hpp>
 #include <eosio/system.hpp>
@@ -8,6 +9,7 @@
 #include <celesos.system/exchange_state.hpp>
 #include <celesos.system/native.hpp>
 
+#include <array>
 #include <deque>
 #include <optional>
 #include <string>
@@ -33,6 +35,10 @@
 
 
 #define TARGET_WOOD_NUMBER 500
+// number of epochs a forest period is sliced into for the per producer wood statistics
+#define WOOD_EPOCHS_PER_PERIOD 12
+// number of forest spaces kept in the difficulty history (current space plus the last 3 read by calc_diff)
+#define WOOD_DIFF_HISTORY_SIZE 4
 
 #define DAPP_PAY_UNACTIVE 1000 * 10000
 // number of bp,BP个数
@@ -45,8 +51,22 @@
 #define REWARD_TIME_SEP 24 * 60 * 60 * uint64_t(1000000)
 // singing ticker sep（唱票间隔期，每隔固定时间进行唱票）
 #define SINGING_TICKER_SEP BP_COUNT * 6 * 60
+// scale of the wood pay accrued per wood, keeps unpaid_wood * wood_reward_per_wood within 128 bits
+#define WOOD_REWARD_PRECISION uint128_t(1000000000000)
+// blocks between two reads of the pay pool balances from the token contract, accrued pay is moved then as well
+#define POOL_BALANCE_SYNC_SEP 600
 // DBP
 #define DBP_ACTIVE_SEP 30 * 24 * 60 * 60 * 2
+// table rows the onblock maintenance jobs may touch per block
+#define MAINTENANCE_ROWS_PER_BLOCK 10
+// wood history rows collected per block by the onblock maintenance
+#define WOOD_GC_ROWS_PER_BLOCK 5
+// matured refunds paid per block by the onblock maintenance
+#define REFUNDS_PER_BLOCK 2
+// producers seeded into prodstats per block by the onblock maintenance, until migrateprods is done
+#define PRODSTATS_ROWS_PER_BLOCK 3
+// userres rows the onblock sweep attenuates per block, sold to the ram market together
+#define RAM_ATTENUATION_BATCH 4
 
 namespace celesossystem {
 
@@ -96,6 +116,7 @@ namespace celesossystem {
    static constexpr int64_t  inflation_pay_factor  = 5;                // 20% of the inflation
    static constexpr int64_t  votepay_factor        = 4;                // 25% of the producer pay
    static constexpr uint32_t refund_delay_sec      = 3 * seconds_per_day;
+   static constexpr uint32_t num_rex_maturity_buckets = 5;             // purchased REX matures after 4 to 5 days
 
 
    /**
@@ -181,7 +202,7 @@ namespace celesossystem {
       uint32_t             total_unpaid_wood = 0;
       bool                 is_network_active = false;
       uint16_t             active_touch_count = 0;
-      uint64_t             last_account = 0;
+      uint64_t             last_account = 0;        /// cursor of the onblock ram attenuation sweep
       uint32_t             network_active_block = 0;
 
       uint32_t             total_wood = 0;
@@ -214,8 +235,67 @@ namespace celesossystem {
                         (total_producer_votepay_share)(revision) )
    };
 
+   /**
+    * Defines new global state parameters added for the wood economy
+    */
+   struct [[eosio::table("global3"), eosio::contract("celesos.system")]] eosio_global_state3 {
+      eosio_global_state3() { }
+
+      bool              woods_migrated = false; ///< `woodburns` has been drained into `woodbins` by `migratewoods`
+      uint32_t          wood_gc_block = 0;      ///< wood history of blocks below this one has been collected by `gcwoods`
+      uint64_t          woodbin_rows = 0;       ///< rows in `woodbins`, expired or not
+      bool              producer_key_changed = false; ///< a producer changed its key since a schedule was last accepted for proposal
+      name              prodstats_cursor;       ///< next `producers` row to be seeded into `prodstats` by `migrateprods`
+      bool              prodstats_migrated = false;
+      int64_t           bpaypool_balance = 0;   ///< `bpaypool_account` balance net of `bpay_pending`, debited by `onblock` between syncs
+      int64_t           wpaypool_balance = 0;   ///< `wpaypool_account` balance net of `wpay_pending`, debited by `onblock` between syncs
+      int64_t           dpaypool_balance = 0;   ///< `dpaypool_account` balance net of `dpay_pending`, debited by `onblock` between syncs
+      uint32_t          pool_balance_block = 0; ///< block the pool balances were last read from the token contract
+      int64_t           bpay_pending = 0;       ///< accrued to `bpay_account` but still held by `bpaypool_account`
+      int64_t           wpay_pending = 0;       ///< accrued to `wpay_account` but still held by `wpaypool_account`
+      int64_t           dpay_pending = 0;       ///< accrued to `dpay_account` but still held by `dpaypool_account`
+      uint128_t         wood_reward_per_wood = 0; ///< wood pay accrued per unpaid wood, times WOOD_REWARD_PRECISION
+      int64_t           wood_reward_undistributed = 0; ///< wood pay accrued while there was no unpaid wood
+      uint128_t         wood_reward_unclaimed = 0;     ///< wood pay shared among unpaid woods and not claimed yet, times WOOD_REWARD_PRECISION
+      bool              wood_reward_started = false;   ///< the `wpay_account` balance of the per balance payouts has been distributed
+      uint32_t          maintenance_pending = 0; ///< bit per `maintenance_job` that is due but has not run yet
+      uint8_t           maintenance_turn = 0;    ///< job the deferrable maintenance jobs start from in the next block
+      std::vector<uint32_t> maintenance_missed;  ///< per `maintenance_job`, blocks that ended with the job still pending
+      uint32_t          ram_sweep_generation = 0; ///< full passes of the ram attenuation cursor `last_account` over `userres`
+
+      EOSLIB_SERIALIZE( eosio_global_state3, (woods_migrated)(wood_gc_block)(woodbin_rows)(producer_key_changed)
+                                             (prodstats_cursor)(prodstats_migrated)
+                                             (bpaypool_balance)(wpaypool_balance)(dpaypool_balance)(pool_balance_block)
+                                             (bpay_pending)(wpay_pending)(dpay_pending)
+                                             (wood_reward_per_wood)(wood_reward_undistributed)(wood_reward_unclaimed)(wood_reward_started)
+                                             (maintenance_pending)(maintenance_turn)(maintenance_missed)(ram_sweep_generation) )
+   };
+
+   /**
+    * Maintenance jobs run by `onblock`, in priority order.
+    *
+    * @details The difficulty and the election are never deferred. The other jobs take turns at the
+    * rows left in the block's MAINTENANCE_ROWS_PER_BLOCK budget.
+    */
+   enum maintenance_job : uint8_t {
+      maintenance_difficulty = 0,
+      maintenance_election,
+      maintenance_prepare_election,
+      maintenance_namebid,
+      maintenance_dbp_activation,
+      maintenance_wood_gc,
+      maintenance_refunds,
+      maintenance_prodstats,
+      maintenance_ram_attenuation,
+      maintenance_job_count
+   };
+
    /**
     * Defines `producer_info` structure to be stored in `producer_info` table, added after version 1.0
+    *
+    * @details Only the registration metadata and `last_claim_time` are maintained here. `valid_woods`,
+    * `unpaid_blocks`, `unpaid_block_fee` and `unpaid_wood` keep the row layout and are only read to
+    * seed a producer's `prodstats` row.
     */
    struct [[eosio::table, eosio::contract("celesos.system")]] producer_info {
       name                  owner;
@@ -239,6 +319,35 @@ namespace celesossystem {
                         (unpaid_blocks)(last_claim_time)(location)(unpaid_block_fee)(unpaid_wood) )
    };
 
+   /**
+    * Defines `producer_stats` structure to be stored in `prodstats` table, the frequently updated
+    * counters of a producer. `is_active` mirrors `producer_info::is_active` so that the election
+    * only reads this table.
+    */
+   struct [[eosio::table, eosio::contract("celesos.system")]] producer_stats {
+      name                  owner;
+      double                valid_woods = 0;
+      bool                  is_active = true;
+      uint32_t              unpaid_blocks = 0;
+      uint32_t              unpaid_block_fee = 0;
+      uint32_t              unpaid_wood = 0;
+      uint128_t             wood_reward_snapshot = 0; /// `wood_reward_per_wood` when `wood_reward_settled` was last updated
+      int64_t               wood_reward_settled = 0;  /// wood pay earned up to `wood_reward_snapshot`
+
+      uint64_t primary_key()const { return owner.value;                             }
+      double   by_votes()const    { return is_active ? -valid_woods : valid_woods;  }
+      bool     active()const      { return is_active;                               }
+
+      /// wood pay earned up to a `wood_reward_per_wood` of `reward_per_wood`
+      int64_t  wood_reward( uint128_t reward_per_wood )const {
+         return wood_reward_settled + static_cast<int64_t>( unpaid_wood * (reward_per_wood - wood_reward_snapshot) / WOOD_REWARD_PRECISION );
+      }
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE( producer_stats, (owner)(valid_woods)(is_active)(unpaid_blocks)(unpaid_block_fee)(unpaid_wood)
+                        (wood_reward_snapshot)(wood_reward_settled) )
+   };
+
    struct [[ eosio::table, eosio::contract("celesos.system") ]] dbp_info {
 
       eosio::name owner;
@@ -336,6 +445,71 @@ namespace celesossystem {
       EOSLIB_SERIALIZE(wood_burn_info, (rowid)(voter)(block_number)(wood))
    };
 
+   struct [[ eosio::table, eosio::contract("celesos.system") ]] wood_burn_bin_info { // wood burn detail, binary encoded
+
+      uint64_t rowid = 0;
+      eosio::name voter; /// the voter
+      uint32_t block_number = 0;
+      eosio::checksum256 wood;
+
+      uint64_t primary_key() const { return rowid; }
+
+      /**
+       * Decodes a hex encoded wood.
+       *
+       * @details A wood is 64 hex characters of either case.
+       *
+       * @return false if `hex` is not a wood, `wood` is left untouched then.
+       */
+      static bool hextowood(const std::string& hex, eosio::checksum256& wood) {
+         if (hex.length() != 2 * 32) {
+            return false;
+         }
+
+         std::array<uint8_t, 32> bytes;
+         for (size_t i = 0; i < hex.length(); i++) {
+            const char ch = hex[i];
+            uint8_t nibble = 0;
+            if (ch >= '0' && ch <= '9') {
+               nibble = ch - '0';
+            } else if (ch >= 'a' && ch <= 'f') {
+               nibble = ch - 'a' + 10;
+            } else if (ch >= 'A' && ch <= 'F') {
+               nibble = ch - 'A' + 10;
+            } else {
+               return false;
+            }
+            bytes[i / 2] = (i % 2) ? (bytes[i / 2] | nibble) : (nibble << 4);
+         }
+
+         wood = eosio::checksum256(bytes);
+         return true;
+      }
+
+      // woods are hashes already, so the wood is its own dedup key
+      eosio::checksum256 get_wood() const {
+         return wood;
+      }
+
+      uint64_t get_block_number() const {
+       return (uint64_t)block_number;
+      }
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE(wood_burn_bin_info, (rowid)(voter)(block_number)(wood))
+   };
+
+   /**
+    * A wood submitted for voting, together with the block number it was mined for.
+    */
+   struct wood_submission {
+      std::string wood;
+      uint32_t    block_number = 0;
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE(wood_submission, (wood)(block_number))
+   };
+
    struct [[ eosio::table, eosio::contract("celesos.system") ]] wood_burn_producer_block_stat { //  wood burn per bp and block stat(木头焚烧按照BP及block_number统计的表)
 
       uint64_t rowid = 0;
@@ -361,6 +535,31 @@ namespace celesossystem {
       EOSLIB_SERIALIZE(wood_burn_producer_block_stat, (rowid)(producer)(block_number)(stat))
    };
 
+   struct [[ eosio::table, eosio::contract("celesos.system") ]] wood_burn_producer_epoch_stat { // wood burn per bp and epoch stat
+
+      uint64_t rowid = 0;
+      eosio::name producer; /// the producer
+      uint32_t epoch = 0;   /// block_number / (forest_period_number() / WOOD_EPOCHS_PER_PERIOD)
+      uint32_t stat = 0;
+
+      uint64_t primary_key() const { return rowid; }
+
+      static uint128_t bpepochkey(eosio::name producer, uint32_t epoch) {
+        return (uint128_t)producer.value << 32 | epoch;
+      }
+
+      uint128_t get_producer_epoch() const {
+         return bpepochkey(producer, epoch);
+      }
+
+      uint64_t get_epoch() const {
+        return (uint64_t)epoch;
+      }
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE(wood_burn_producer_epoch_stat, (rowid)(producer)(epoch)(stat))
+   };
+
    struct [[ eosio::table, eosio::contract("celesos.system") ]] wood_burn_block_stat {
 
       uint32_t block_number = 0;
@@ -373,6 +572,34 @@ namespace celesossystem {
       EOSLIB_SERIALIZE(wood_burn_block_stat, (block_number)(stat)(diff))
 }; // 按照block_number统计的表，用于难度调整
 
+   struct wood_diff_slot {
+      uint32_t block_number = 0; /// the first block of the forest space this slot belongs to
+      uint32_t stat = 0;
+      double diff = 0;
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE(wood_diff_slot, (block_number)(stat)(diff))
+   };
+
+   /**
+    * Difficulty history ring buffer.
+    *
+    * @details Slot `block_number / forest_space_number() % WOOD_DIFF_HISTORY_SIZE` holds the wood count
+    * and the difficulty of the forest space starting at `block_number`, older spaces are overwritten.
+    */
+   struct [[eosio::table("wooddiff"), eosio::contract("celesos.system")]] wood_diff_history {
+      std::vector<wood_diff_slot> slots;
+
+      wood_diff_slot& slot(uint32_t block_number, uint32_t forest_space) {
+         if (slots.size() != WOOD_DIFF_HISTORY_SIZE)
+            slots.resize(WOOD_DIFF_HISTORY_SIZE);
+         return slots[(block_number / forest_space) % WOOD_DIFF_HISTORY_SIZE];
+      }
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE(wood_diff_history, (slots))
+   };
+
    /**
     * Voters table
     *
@@ -385,23 +612,58 @@ namespace celesossystem {
 
    typedef eosio::multi_index<"bppunish"_n, bp_punish_info> bp_punish_table;
 
+   /**
+    * Legacy hex encoded wood burn table
+    *
+    * @details No longer written, `migratewoods` moves its rows to `woodbins`. Until it is empty,
+    * duplicate checks also scan the `wood` index, which every row carries.
+    */
    typedef eosio::multi_index<"woodburns"_n, wood_burn_info,
                            indexed_by<"wood"_n, const_mem_fun<wood_burn_info, uint64_t, &wood_burn_info::get_wood_index>>,
                            indexed_by<"blocknumber"_n, const_mem_fun<wood_burn_info, uint64_t, &wood_burn_info::get_block_number>>>
    wood_burn_table;
 
+   /**
+    * Wood burn table, holds the woods burnt during the current forest period.
+    */
+   typedef eosio::multi_index<"woodbins"_n, wood_burn_bin_info,
+                           indexed_by<"wood"_n, const_mem_fun<wood_burn_bin_info, eosio::checksum256, &wood_burn_bin_info::get_wood>>,
+                           indexed_by<"blocknumber"_n, const_mem_fun<wood_burn_bin_info, uint64_t, &wood_burn_bin_info::get_block_number>>>
+   wood_burn_bin_table;
+
    typedef eosio::multi_index<"woodbpblocks"_n, wood_burn_producer_block_stat,
                            indexed_by<"prodblock"_n, const_mem_fun<wood_burn_producer_block_stat, uint128_t, &wood_burn_producer_block_stat::get_producer_block>>,
                            indexed_by<"blocknumber"_n, const_mem_fun<wood_burn_producer_block_stat, uint64_t, &wood_burn_producer_block_stat::get_block_number>>>
    wood_burn_producer_block_table;
 
+   /**
+    * Per producer and epoch wood table, bounded by producers x WOOD_EPOCHS_PER_PERIOD rows.
+    * `woodbpblocks` is no longer written and only drained of the rows recorded before it.
+    */
+   typedef eosio::multi_index<"woodbpepochs"_n, wood_burn_producer_epoch_stat,
+                           indexed_by<"prodepoch"_n, const_mem_fun<wood_burn_producer_epoch_stat, uint128_t, &wood_burn_producer_epoch_stat::get_producer_epoch>>,
+                           indexed_by<"epoch"_n, const_mem_fun<wood_burn_producer_epoch_stat, uint64_t, &wood_burn_producer_epoch_stat::get_epoch>>>
+   wood_burn_producer_epoch_table;
+
+   /**
+    * Per block difficulty table, superseded by `wood_diff_history_singleton` and only read for
+    * the forest spaces recorded before it existed.
+    */
    typedef eosio::multi_index<"woodblocks"_n, wood_burn_block_stat> wood_burn_block_stat_table;
 
+   typedef eosio::singleton<"wooddiff"_n, wood_diff_history> wood_diff_history_singleton;
+
    /**
     * Defines producer info table added in version 1.0
     */
    typedef eosio::multi_index<"producers"_n, producer_info,
                            indexed_by<"prototalvote"_n, const_mem_fun<producer_info, double, &producer_info::by_votes>>> producers_table;
+
+   /**
+    * Producer counters table, one row per registered producer
+    */
+   typedef eosio::multi_index<"prodstats"_n, producer_stats,
+                           indexed_by<"prototalvote"_n, const_mem_fun<producer_stats, double, &producer_stats::by_votes>>> producer_stats_table;
    /**
     * Global state singleton added in version 1.0
     */
@@ -410,6 +672,10 @@ namespace celesossystem {
     * Global state singleton added in version 1.1.0
     */
    typedef eosio::singleton< "global2"_n, eosio_global_state2 > global_state2_singleton;
+   /**
+    * Global state singleton added for the wood economy
+    */
+   typedef eosio::singleton< "global3"_n, eosio_global_state3 > global_state3_singleton;
 
    struct [[eosio::table, eosio::contract("celesos.system")]] user_resources {
       name          owner;
@@ -462,6 +728,32 @@ namespace celesossystem {
    typedef eosio::multi_index< "delband"_n, delegated_bandwidth > del_bandwidth_table;
    typedef eosio::multi_index< "refunds"_n, refund_request >      refunds_table;
 
+   /**
+    * Pending stake or bid refund, in the `_self` scope.
+    *
+    * @details The refund itself stays in `refunds` or `bidrefunds`. The queue only orders the refunds by
+    * the time they mature, so `onblock` and `procrefunds` pay a refund only once it is due, instead of
+    * scheduling and cancelling a deferred transaction on every unstake or outbid.
+    */
+   struct [[eosio::table, eosio::contract("celesos.system")]] refund_queue_entry {
+      uint64_t        id;
+      name            owner;
+      name            newname;   ///< name of a bid refund, empty for a stake refund
+      time_point_sec  maturity;
+
+      uint64_t  primary_key()const { return id; }
+      uint128_t by_refund()const   { return (uint128_t(newname.value) << 64) | owner.value; }
+      uint64_t  by_maturity()const { return uint64_t(maturity.sec_since_epoch()); }
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE( refund_queue_entry, (id)(owner)(newname)(maturity) )
+   };
+
+   typedef eosio::multi_index< "refundqueue"_n, refund_queue_entry,
+                               indexed_by<"byrefund"_n, const_mem_fun<refund_queue_entry, uint128_t, &refund_queue_entry::by_refund>>,
+                               indexed_by<"bymaturity"_n, const_mem_fun<refund_queue_entry, uint64_t, &refund_queue_entry::by_maturity>>
+                             > refund_queue_table;
+
    /**
     * `rex_pool` structure underlying the rex pool table.
     *
@@ -519,15 +811,66 @@ namespace celesossystem {
     */
    typedef eosio::multi_index< "rexfund"_n, rex_fund > rex_fund_table;
 
+   /**
+    * Fixed-capacity REX maturity buckets of a `rex_balance`.
+    *
+    * @details REX bought on day `d` matures at the start of day `d + 5`, so at most
+    * `num_rex_maturity_buckets` buckets are pending at any time. `amounts[day % num_rex_maturity_buckets]`
+    * holds the REX maturing at the start of `day`, for the days up to `last_day`.
+    */
+   struct rex_maturity_buckets {
+      uint32_t                                       last_day = 0; ///< days since epoch of the latest maturity
+      std::array<int64_t, num_rex_maturity_buckets> amounts{};
+      int64_t                                        savings  = 0; ///< REX in savings, never matures
+
+      /**
+       * Adds `rex` maturing at `maturity`. The buckets it reuses held REX matured before
+       * `maturity - num_rex_maturity_buckets` days and are moved to `matured_rex`.
+       */
+      void add( time_point_sec maturity, int64_t rex, int64_t& matured_rex ) {
+         const uint32_t day = maturity.sec_since_epoch() / seconds_per_day;
+         check( day + num_rex_maturity_buckets > last_day, "rex maturity is out of the bucket range" );
+         for ( uint32_t d = last_day + 1; d <= day && d <= last_day + num_rex_maturity_buckets; ++d ) {
+            matured_rex += amounts[d % num_rex_maturity_buckets];
+            amounts[d % num_rex_maturity_buckets] = 0;
+         }
+         last_day = std::max( last_day, day );
+         amounts[day % num_rex_maturity_buckets] += rex;
+      }
+
+      /// Moves the buckets matured at `now` to `matured_rex`.
+      void process( time_point_sec now, int64_t& matured_rex ) {
+         for ( uint32_t i = 0; i < num_rex_maturity_buckets && i <= last_day; ++i ) {
+            const uint32_t day = last_day - i;
+            if ( uint64_t(day) * seconds_per_day <= now.sec_since_epoch() ) {
+               matured_rex += amounts[day % num_rex_maturity_buckets];
+               amounts[day % num_rex_maturity_buckets] = 0;
+            }
+         }
+      }
+
+      int64_t total()const {
+         int64_t sum = 0;
+         for ( const auto amount : amounts ) {
+            sum += amount;
+         }
+         return sum;
+      }
+
+      EOSLIB_SERIALIZE( rex_maturity_buckets, (last_day)(amounts)(savings) )
+   };
+
    /**
     * `rex_balance` structure underlying the rex balance table.
     *
     * @details A rex balance table entry is defined by:
-    * - `version` defaulted to zero,
+    * - `version` zero for rows still using `rex_maturities`, one once converted to `maturity_buckets`,
     * - `owner` the owner of the rex fund,
     * - `vote_stake` the amount of CORE_SYMBOL currently included in owner's vote,
     * - `rex_balance` the amount of REX owned by owner,
-    * - `matured_rex` matured REX available for selling.
+    * - `matured_rex` matured REX available for selling,
+    * - `rex_maturities` the variable length maturity buckets of version zero rows, empty once converted,
+    * - `maturity_buckets` the fixed-capacity maturity buckets and savings.
     */
    struct [[eosio::table,eosio::contract("celesos.system")]] rex_balance {
       uint8_t version = 0;
@@ -536,8 +879,39 @@ namespace celesossystem {
       asset   rex_balance;
       int64_t matured_rex = 0;
       std::deque<std::pair<time_point_sec, int64_t>> rex_maturities; /// REX daily maturity buckets
+      eosio::binary_extension<rex_maturity_buckets>  maturity_buckets;
 
       uint64_t primary_key()const { return owner.value; }
+
+      /// Maturity buckets of the row, converted from `rex_maturities` on first use.
+      rex_maturity_buckets& buckets() {
+         if ( !maturity_buckets.has_value() ) {
+            rex_maturity_buckets converted;
+            for ( const auto& m : rex_maturities ) {
+               if ( m.first == time_point_sec::maximum() ) {
+                  converted.savings += m.second;
+               } else {
+                  converted.add( m.first, m.second, matured_rex );
+               }
+            }
+            rex_maturities.clear();
+            maturity_buckets.emplace( converted );
+            version = 1;
+         }
+         return maturity_buckets.value();
+      }
+
+      int64_t savings()const {
+         if ( maturity_buckets.has_value() ) {
+            return maturity_buckets.value().savings;
+         }
+         if ( !rex_maturities.empty() && rex_maturities.back().first == time_point_sec::maximum() ) {
+            return rex_maturities.back().second;
+         }
+         return 0;
+      }
+
+      EOSLIB_SERIALIZE( rex_balance, (version)(owner)(vote_stake)(rex_balance)(matured_rex)(rex_maturities)(maturity_buckets) )
    };
 
    /**
@@ -634,10 +1008,17 @@ namespace celesossystem {
       private:
          voters_table            _voters;
          producers_table         _producers;
+         producer_stats_table    _prodstats;
          global_state_singleton  _global;
          global_state2_singleton _global2;
+         global_state3_singleton _global3;
          eosio_global_state      _gstate;
          eosio_global_state2     _gstate2;
+         eosio_global_state3     _gstate3;
+         // global states as read by the constructor, the destructor only writes the ones that changed
+         std::vector<char>       _gstate_packed;
+         std::vector<char>       _gstate2_packed;
+         std::vector<char>       _gstate3_packed;
          rammarket               _rammarket;
          rex_pool_table          _rexpool;
          rex_fund_table          _rexfunds;
@@ -648,7 +1029,9 @@ namespace celesossystem {
          bp_punish_table _dbpunishs;
 
          wood_burn_table _burninfos;
+         wood_burn_bin_table _burnbininfos;
          wood_burn_producer_block_table _burnproducerstatinfos;
+         wood_burn_producer_epoch_table _burnproducerepochinfos;
          wood_burn_block_stat_table _burnblockstatinfos;
 
       public:
@@ -1087,10 +1470,9 @@ namespace celesossystem {
           * left to delegate.
           * This will cause an immediate reduction in net/cpu bandwidth of the
           * receiver.
-          * A transaction is scheduled to send the tokens back to `from` after
-          * the staking period has passed. If existing transaction is scheduled, it
-          * will be canceled and a new transaction issued that has the combined
-          * undelegated amount.
+          * A refund is queued to send the tokens back to `from` after
+          * the staking period has passed. If a refund is already queued, it
+          * is rescheduled with the combined undelegated amount.
           * The `from` account loses voting power as a result of this call and
           * all producer tallies are updated.
           *
@@ -1101,12 +1483,12 @@ namespace celesossystem {
           * @param unstake_net_quantity - tokens to be unstaked from NET bandwidth,
           * @param unstake_cpu_quantity - tokens to be unstaked from CPU bandwidth,
           *
-          * @post Unstaked tokens are transferred to `from` liquid balance via a
-          *    deferred transaction with a delay of 3 days.
+          * @post Unstaked tokens are transferred to `from` liquid balance after a delay
+          *    of 3 days, by `onblock`, `procrefunds` or `refund`.
           * @post If called during the delay period of a previous `undelegatebw`
           *    action, pending action is canceled and timer is reset.
           * @post All producers `from` account has voted for will have their votes updated immediately.
-          * @post Bandwidth and storage for the deferred transaction are billed to `from`.
+          * @post Storage for the refund and its queue entry is billed to `from`.
           */
          [[eosio::action]]
          void undelegatebw( const name& from, const name& receiver,
@@ -1151,6 +1533,17 @@ namespace celesossystem {
          [[eosio::action]]
          void sellram( const name& account, int64_t bytes );
 
+         /**
+          * Touch ram action.
+          *
+          * @details Applies the RAM attenuation `account` has accrued since it was last touched,
+          * selling the attenuated bytes to the ram market. Anyone may call it, it stores no row of its own.
+          *
+          * @param account - the account whose RAM is attenuated.
+          */
+         [[eosio::action]]
+         void touchram( const name& account );
+
          /**
           * Refund action.
           *
@@ -1162,6 +1555,18 @@ namespace celesossystem {
          [[eosio::action]]
          void refund( const name& owner );
 
+         /**
+          * Process refunds action.
+          *
+          * @details Pays up to `max_rows` matured stake and bid refunds off the refund queue, oldest
+          * first. `onblock` pays a few every block, anyone may pay more. The owners are credited by
+          * `transfermany` without being notified.
+          *
+          * @param max_rows - the maximum number of refunds to pay in this call.
+          */
+         [[eosio::action]]
+         void procrefunds( uint32_t max_rows );
+
          // functions defined in voting.cpp
 
          /**
@@ -1242,6 +1647,60 @@ namespace celesossystem {
          void voteproducer( const eosio::name voter_name, const eosio::name wood_owner_name, std::string wood,
                                         const uint32_t block_number, const eosio::name producer_name);
 
+         /**
+          * Vote producer with many woods action.
+          *
+          * @details Burns every wood in `woods` for `producer_name` in one call. Each wood is
+          * verified and recorded exactly as in `voteproducer`, while the producer, per-block and
+          * global counters are updated once per row instead of once per wood.
+          *
+          * @param voter_name - the account submitting the woods,
+          * @param wood_owner_name - the owner of the woods if `voter_name` votes as its proxy,
+          * @param woods - the (wood, block_number) pairs to burn,
+          * @param producer_name - the producer all woods are burnt for.
+          */
+         [[eosio::action]]
+         void votewoods( const eosio::name voter_name, const eosio::name wood_owner_name,
+                         const std::vector<wood_submission>& woods, const eosio::name producer_name );
+
+         /**
+          * Migrate woods action.
+          *
+          * @details Moves up to `max_rows` rows of the legacy hex encoded `woodburns` table to the
+          * binary `woodbins` table. Rows that have left the forest period or that do not hold a
+          * valid wood are dropped. Until `woodburns` is empty, duplicate wood checks also scan it.
+          *
+          * @param max_rows - the maximum number of rows to migrate in this call.
+          */
+         [[eosio::action]]
+         void migratewoods( uint32_t max_rows );
+
+         /**
+          * Collect wood history action.
+          *
+          * @details Erases up to `max_rows` rows of wood history that have left the forest period,
+          * subtracting expired woods from their producers first, then burnt woods, then the legacy
+          * per block difficulty rows. Anyone may pay for it, it fails once the history is collected
+          * up to the current block.
+          *
+          * @param max_rows - the maximum number of rows to erase in this call.
+          */
+         [[eosio::action]]
+         void gcwoods( uint32_t max_rows );
+
+         /**
+          * Migrate producers action.
+          *
+          * @details Seeds the `prodstats` rows of up to `max_rows` producers from their `producers`
+          * rows. Producers touched by a vote, payout or registration are seeded on the way, and
+          * `onblock` seeds a few every block. Until every producer has been visited, elections keep
+          * the current schedule.
+          *
+          * @param max_rows - the maximum number of producers to visit in this call.
+          */
+         [[eosio::action]]
+         void migrateprods( uint32_t max_rows );
+
          /**
           * Register proxy action.
           *
@@ -1437,7 +1896,9 @@ namespace celesossystem {
          using buyram_action = eosio::action_wrapper<"buyram"_n, &system_contract::buyram>;
          using buyrambytes_action = eosio::action_wrapper<"buyrambytes"_n, &system_contract::buyrambytes>;
          using sellram_action = eosio::action_wrapper<"sellram"_n, &system_contract::sellram>;
+         using touchram_action = eosio::action_wrapper<"touchram"_n, &system_contract::touchram>;
          using refund_action = eosio::action_wrapper<"refund"_n, &system_contract::refund>;
+         using procrefunds_action = eosio::action_wrapper<"procrefunds"_n, &system_contract::procrefunds>;
          using regproducer_action = eosio::action_wrapper<"regproducer"_n, &system_contract::regproducer>;
          using unregprod_action = eosio::action_wrapper<"unregprod"_n, &system_contract::unregprod>;
          using setram_action = eosio::action_wrapper<"setram"_n, &system_contract::setram>;
@@ -1459,6 +1920,10 @@ namespace celesossystem {
          using activedbp_action = eosio::action_wrapper<"activedbp"_n, &system_contract::activedbp>;
          using setnamelist_action = eosio::action_wrapper<"setnamelist"_n, &system_contract::setnamelist>;
          using setproxy_action = eosio::action_wrapper<"setproxy"_n, &system_contract::setproxy>;
+         using votewoods_action = eosio::action_wrapper<"votewoods"_n, &system_contract::votewoods>;
+         using migratewoods_action = eosio::action_wrapper<"migratewoods"_n, &system_contract::migratewoods>;
+         using gcwoods_action = eosio::action_wrapper<"gcwoods"_n, &system_contract::gcwoods>;
+         using migrateprods_action = eosio::action_wrapper<"migrateprods"_n, &system_contract::migrateprods>;
 
       private:
          // Implementation details:
@@ -1480,6 +1945,7 @@ namespace celesossystem {
          void check_voting_requirement( const name& owner,
                                         const char* error_msg = "must vote for at least 21 producers or for a proxy before buying REX" )const;
          rex_order_outcome fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex );
+         rex_order_outcome fill_rex_order( rex_pool& rt, const rex_balance_table::const_iterator& bitr, const asset& rex );
          asset update_rex_account( const name& owner, const asset& proceeds, const asset& unstake_quant, bool force_vote_update = false );
          void channel_to_rex( const name& from, const asset& amount );
          void channel_namebid_to_rex( const int64_t highest_bid );
@@ -1500,12 +1966,11 @@ namespace celesossystem {
          void process_rex_maturities( const rex_balance_table::const_iterator& bitr );
          void consolidate_rex_balance( const rex_balance_table::const_iterator& bitr,
                                        const asset& rex_in_sell_order );
-         int64_t read_rex_savings( const rex_balance_table::const_iterator& bitr );
-         void put_rex_savings( const rex_balance_table::const_iterator& bitr, int64_t rex );
          void update_rex_stake( const name& voter );
 
          void add_loan_to_rex_pool( const asset& payment, int64_t rented_tokens, bool new_loan );
-         void remove_loan_from_rex_pool( const rex_loan& loan );
+         static void add_loan_to_rex_pool( rex_pool& rt, const asset& payment, int64_t rented_tokens, bool new_loan );
+         static void remove_loan_from_rex_pool( rex_pool& rt, const rex_loan& loan );
          template <typename Index, typename Iterator>
          int64_t update_renewed_loan( Index& idx, const Iterator& itr, int64_t rented_tokens );
 
@@ -1513,26 +1978,51 @@ namespace celesossystem {
          void changebw( name from, const name& receiver,
                         const asset& stake_net_quantity, const asset& stake_cpu_quantity, bool transfer );
          // void update_voting_power( const name& voter, const asset& total_update );
+         void enqueue_refund( const name& owner, const name& newname, time_point_sec maturity, const name& payer );
+         void dequeue_refund( const name& owner, const name& newname );
+         void pay_refund( const name& owner );
+         void pay_bid_refund( const name& bidder, const name& newname );
+         bool has_matured_refunds();
+         void migrate_producer_stats(uint32_t max_rows);
+         uint32_t process_refunds( uint32_t max_rows );
+
+         // defined in producer_pay.cpp
+         void run_maintenance(uint32_t head_block_number, block_timestamp timestamp);
+         void flush_pay_pools();
+         void accrue_wood_reward(int64_t amount);
 
          // defined in voting.hpp
          void update_elected_producers(uint32_t head_block_number);
+         producer_stats_table::const_iterator get_producer_stats(const eosio::name& owner);
          void update_votes( const name& voter, const name& proxy, const std::vector<name>& producers, bool voting );
 
-         bool verify(const std::string wood, const uint32_t block_number, const eosio::name wood_owner_name);
+         bool verify(const std::string wood, const eosio::checksum256 &woodbin,
+                     const uint32_t block_number, const eosio::name wood_owner_name);
 
          uint32_t clean_dirty_stat_producers(uint32_t block_number, uint32_t maxline);
 
-         void clean_diff_stat_history(uint32_t block_number);
+         template <typename Index>
+         uint32_t expire_producer_stats(Index& idx, uint64_t bound, uint32_t maxline);
+
+         static uint32_t wood_epoch_blocks();
 
          uint32_t clean_dirty_wood_history(uint32_t block_number, uint32_t maxline);
 
+         bool has_expired_wood_history(uint32_t head_block_number);
+         uint32_t collect_wood_history(uint32_t head_block_number, uint32_t max_rows);
+
+         template <typename Table>
+         uint32_t expire_wood_history(Table& table, uint32_t bound, uint32_t maxline);
+
          double calc_diff(uint32_t block_number);
 
          void update_vote(const eosio::name voter_name, const eosio::name wood_owner_name,
-                     const std::string wood, const uint32_t block_number, const eosio::name producer_name);
+                     const std::vector<wood_submission>& woods, const eosio::name producer_name);
 
          void ramattenuator();
          void ramattenuator(eosio::name account);
+         int64_t attenuate_ram(user_resources_table& userres, user_resources_table::const_iterator item);
+         void sell_attenuated_ram(int64_t bytes);
 
          template <auto system_contract::*...Ptrs>
          class registration {
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace celesossystem {
+
+   /**
+    * @addtogroup celesossystem
+    * @{
+    */
+
+   /**
+    * Halving tier of a pool that started with `full` tokens and still holds `balance`.
+    *
+    * @details Equals `floor(log(full / balance) / log(2))` with integer division, computed by counting
+    * leading zeros. The double expression only rounds across a power of two from 2^48 - 1 on, so both
+    * agree for every `full` accepted by `reward_schedule`. A balance above `full` is in tier 0.
+    *
+    * @pre `balance` is positive
+    */
+   constexpr uint32_t halving_tier( uint64_t full, uint64_t balance ) {
+      const uint64_t quotient = full / balance;
+      return quotient == 0 ? 0 : 63 - __builtin_clzll( quotient );
+   }
+
+   /**
+    * Per block payout of a reward pool that starts with `Full` tokens and pays `Origin` tokens per block
+    * in tier 0, halving with every tier and never dropping below 1.
+    */
+   template<uint64_t Full, int64_t Origin>
+   struct reward_schedule {
+      static_assert( Full > 0 && Full < (uint64_t(1) << 47), "halving_tier is only exact for quotients below 2^47" );
+      static_assert( Origin > 0, "a reward pool must pay a positive amount" );
+
+      /// number of tiers, the last one is reached with a balance of 1
+      static constexpr uint32_t tiers = 64 - __builtin_clzll( Full );
+
+      static constexpr std::array<int64_t, tiers> make_amounts() {
+         std::array<int64_t, tiers> amounts{};
+         for( uint32_t tier = 0; tier < tiers; ++tier ) {
+            const int64_t halved = tier < 63 ? Origin >> tier : 0;
+            amounts[tier] = halved > 1 ? halved : 1;
+         }
+         return amounts;
+      }
+
+      static constexpr std::array<int64_t, tiers> amounts = make_amounts();
+
+      /**
+       * Amount to pay out of a pool holding `balance`.
+       *
+       * @pre `balance` is positive
+       */
+      static constexpr int64_t amount( int64_t balance ) {
+         return amounts[ halving_tier( Full, static_cast<uint64_t>(balance) ) ];
+      }
+   };
+
+   static_assert( halving_tier( 1000, 1000 ) == 0 && halving_tier( 1000, 501 ) == 0 && halving_tier( 1000, 500 ) == 1 );
+   static_assert( halving_tier( 1000, 2000 ) == 0 && halving_tier( 1000, 1 ) == 9 );
+   static_assert( reward_schedule<1000, 5000>::tiers == 10 );
+   static_assert( reward_schedule<1000, 5000>::amount( 1000 ) == 5000 && reward_schedule<1000, 5000>::amount( 500 ) == 2500 );
+   static_assert( reward_schedule<1000, 5000>::amount( 1 ) == 9 && reward_schedule<(1 << 20), 5000>::amount( 1 ) == 1 );
+
+   /** @}*/ // end of @addtogroup celesossystem
+} /// namespace celesossystem
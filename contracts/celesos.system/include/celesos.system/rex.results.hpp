@@ -13,6 +13,13 @@ class [[eosio::contract("rex.results")]] rex_results : eosio::contract {
 
       using eosio::contract::contract;
 
+      struct order_result {
+         name  owner;
+         asset proceeds;
+
+         EOSLIB_SERIALIZE( order_result, (owner)(proceeds) )
+      };
+
       [[eosio::action]]
       void buyresult( const asset& rex_received );
 
@@ -22,11 +29,15 @@ class [[eosio::contract("rex.results")]] rex_results : eosio::contract {
       [[eosio::action]]
       void orderresult( const name& owner, const asset& proceeds );
 
+      [[eosio::action]]
+      void orderresults( const std::vector<order_result>& results );
+
       [[eosio::action]]
       void rentresult( const asset& rented_tokens );
 
-      using buyresult_action   = action_wrapper<"buyresult"_n,   &rex_results::buyresult>;
-      using sellresult_action  = action_wrapper<"sellresult"_n,  &rex_results::sellresult>;
-      using orderresult_action = action_wrapper<"orderresult"_n, &rex_results::orderresult>;
-      using rentresult_action  = action_wrapper<"rentresult"_n,  &rex_results::rentresult>;
+      using buyresult_action    = action_wrapper<"buyresult"_n,    &rex_results::buyresult>;
+      using sellresult_action   = action_wrapper<"sellresult"_n,   &rex_results::sellresult>;
+      using orderresult_action  = action_wrapper<"orderresult"_n,  &rex_results::orderresult>;
+      using orderresults_action = action_wrapper<"orderresults"_n, &rex_results::orderresults>;
+      using rentresult_action   = action_wrapper<"rentresult"_n,   &rex_results::rentresult>;
 };
@@ -13,12 +13,16 @@ namespace celesossystem {
    :native(s,code,ds),
     _voters(get_self(), get_self().value),
     _producers(get_self(), get_self().value),
+    _prodstats(get_self(), get_self().value),
     _global(get_self(), get_self().value),
     _global2(get_self(), get_self().value),
+    _global3(get_self(), get_self().value),
     _dbps(get_self(), get_self().value),
     _dbpunishs(get_self(), get_self().value),
     _burninfos(get_self(), get_self().value),
+    _burnbininfos(get_self(), get_self().value),
     _burnproducerstatinfos(get_self(), get_self().value),
+    _burnproducerepochinfos(get_self(), get_self().value),
     _burnblockstatinfos(get_self(), get_self().value),
     _rammarket(get_self(), get_self().value),
     _rexpool(get_self(), get_self().value),
@@ -27,8 +31,21 @@ namespace celesossystem {
     _rexorders(get_self(), get_self().value)
    {
       //print( "construct system\n" );
-      _gstate  = _global.exists() ? _global.get() : get_default_parameters();
-      _gstate2 = _global2.exists() ? _global2.get() : eosio_global_state2{};
+      // a missing singleton keeps an empty snapshot, so it is written out by the destructor
+      if( _global.exists() ) {
+         _gstate = _global.get();
+         _gstate_packed = eosio::pack( _gstate );
+      } else {
+         _gstate = get_default_parameters();
+      }
+      if( _global2.exists() ) {
+         _gstate2 = _global2.get();
+         _gstate2_packed = eosio::pack( _gstate2 );
+      }
+      if( _global3.exists() ) {
+         _gstate3 = _global3.get();
+         _gstate3_packed = eosio::pack( _gstate3 );
+      }
    }
 
    eosio_global_state system_contract::get_default_parameters() {
@@ -42,9 +59,17 @@ namespace celesossystem {
       return sym;
    }
 
+   /**
+    * Writes back the global states the action changed. `onblock` changes `_gstate3` in every block,
+    * at least `maintenance_turn`, so that row is still written once per block.
+    */
    system_contract::~system_contract() {
-      _global.set( _gstate, get_self() );
-      _global2.set( _gstate2, get_self() );
+      if( eosio::pack( _gstate ) != _gstate_packed )
+         _global.set( _gstate, get_self() );
+      if( eosio::pack( _gstate2 ) != _gstate2_packed )
+         _global2.set( _gstate2, get_self() );
+      if( eosio::pack( _gstate3 ) != _gstate3_packed )
+         _global3.set( _gstate3, get_self() );
    }
 
    void system_contract::setram( uint64_t max_ram_size ) {
@@ -267,6 +292,9 @@ namespace celesossystem {
       _producers.modify( prod, same_payer, [&](auto& p) {
             p.deactivate();
          });
+      _prodstats.modify( get_producer_stats( producer ), same_payer, [&](auto& s) {
+            s.is_active = false;
+         });
    }
 
    void system_contract::updtrevision( uint8_t revision ) {
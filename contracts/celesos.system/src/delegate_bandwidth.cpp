@@ -169,31 +169,57 @@ namespace celesossystem {
      * CELES CODE
      * @author cuichao
      * ram随时间衰减函数
+     *
+     * Applies the attenuation `account` has accrued since it was last touched. The chain keeps the time
+     * of the last attenuation and `ram_attenuation` returns the decay since then in closed form, so the
+     * contract keeps no state of its own for it.
      */
    void system_contract::ramattenuator(eosio::name account) {
 
       user_resources_table userres(_self, _self.value);
-      auto item = userres.lower_bound(account.value);
-
-      //如果没有找到记录，取第一条  （表可能是空，或者已经是最后一条记录）
-      if (item == userres.end()) {
-         item = userres.begin();
-      }
+      auto item = userres.find(account.value);
 
       if (item == userres.end()) {
          return;
       }
 
-      int64_t bytes = eosio::internal_use_do_not_use::ram_attenuation(account.value);
+      sell_attenuated_ram(attenuate_ram(userres, item));
+   }
+
+   /**
+    * Takes the RAM the owner of the `userres` row `item` has lost to attenuation since it was last attenuated.
+    *
+    * @return the bytes taken, which still have to be sold to the ram market by `sell_attenuated_ram`
+    */
+   int64_t system_contract::attenuate_ram(user_resources_table& userres, user_resources_table::const_iterator item) {
+
+      int64_t bytes = eosio::internal_use_do_not_use::ram_attenuation(item->owner.value);
 
       if (bytes <= 0) {
-         return;
+         return 0;
       }
 
-      int64_t ram1 = item->ram_bytes;
-      int64_t ram_bytes = ram1 - bytes;
+      int64_t ram_bytes = item->ram_bytes - bytes;
 
       if (ram_bytes <= 0) {
+         return 0;
+      }
+
+      userres.modify(item, item->owner, [&](auto &res) {
+         res.ram_bytes = ram_bytes;
+      });
+
+      eosio::internal_use_do_not_use::set_resource_limits(item->owner.value, item->ram_bytes, item->net_weight.amount, item->cpu_weight.amount);
+
+      return bytes;
+   }
+
+   /**
+    * Sells `bytes` of attenuated RAM to the ram market and moves the proceeds from celes.ram to celes.ramfee.
+    */
+   void system_contract::sell_attenuated_ram(int64_t bytes) {
+
+      if (bytes <= 0) {
          return;
       }
 
@@ -205,28 +231,28 @@ namespace celesossystem {
          tokens_out = es.convert(asset(bytes, ram_symbol), core_symbol());
       });
 
+      _gstate.total_ram_bytes_reserved -= static_cast<decltype(_gstate.total_ram_bytes_reserved)>(bytes); // bytes > 0 is asserted above
+
       if (tokens_out.amount <= 0) {
          return;
       }
 
-      _gstate.total_ram_bytes_reserved -= static_cast<decltype(_gstate.total_ram_bytes_reserved)>(bytes); // bytes > 0 is asserted above
       _gstate.total_ram_stake -= tokens_out.amount;
 
-      userres.modify(item, item->owner, [&](auto &res) {
-         res.ram_bytes = ram_bytes;
-      });
-
       //将收取的费用从celes.ram转入celes.ramfee账户
       celes::token::transfer_action transfer_act{ token_account, { {ram_account, active_permission} } };
       transfer_act.send(ram_account, ramfee_account, tokens_out, std::string("ram fee"));
-
-      eosio::internal_use_do_not_use::set_resource_limits(item->owner.value, item->ram_bytes, item->net_weight.amount, item->cpu_weight.amount);
    }
 
    /**
      * CELES CODE
      * @author cuichao
      * ram随时间衰减函数
+     *
+     * Attenuates up to RAM_ATTENUATION_BATCH rows from the sweep cursor on, selling their bytes to
+     * the ram market in a single conversion and moving the proceeds in a single transfer. Accounts
+     * that are never touched are attenuated this way, the decay is in closed form so a sweep and a
+     * touch of the same account do not overlap.
      */
    void system_contract::ramattenuator() {
 
@@ -236,7 +262,7 @@ namespace celesossystem {
       if (temp > 0) {
          last = temp;
       }
-    
+
       user_resources_table userres(_self, _self.value);
       auto item = userres.lower_bound(last);
 
@@ -249,16 +275,25 @@ namespace celesossystem {
          return;
       }
 
+      int64_t bytes = 0;
       //TODO 考虑系统账户
-      ramattenuator(item->owner);
+      for (uint32_t i = 0; i < RAM_ATTENUATION_BATCH && item != userres.end(); ++i, ++item) {
+         bytes += attenuate_ram(userres, item);
+      }
 
-      item++;
       if (item == userres.end())
       {
          item = userres.begin();
+         _gstate3.ram_sweep_generation++;
       }
 
       _gstate.last_account = item->owner.value;
+
+      sell_attenuated_ram(bytes);
+   }
+
+   void system_contract::touchram( const name& account ) {
+      ramattenuator(account);
    }
 
    void validate_b1_vesting( int64_t stake ) {
@@ -424,16 +459,10 @@ namespace celesossystem {
          } /// end if is_delegating_to_self || is_undelegating
 
          if ( need_deferred_trx ) {
-            eosio::transaction out;
-            out.actions.emplace_back( permission_level{from, active_permission},
-                                      get_self(), "refund"_n,
-                                      from
-            );
-            out.delay_sec = refund_delay_sec;
-            eosio::cancel_deferred( from.value ); // TODO: Remove this line when replacing deferred trxs is fixed
-            out.send( from.value, from, true );
+            const auto& r = refunds_tbl.get( from.value );
+            enqueue_refund( from, name(), time_point_sec( r.request_time.sec_since_epoch() + refund_delay_sec ), from );
          } else {
-            eosio::cancel_deferred( from.value );
+            dequeue_refund( from, name() );
          }
 
          auto transfer_amount = net_balance + cpu_balance;
@@ -482,6 +511,8 @@ namespace celesossystem {
       check( stake_net_quantity.amount + stake_cpu_quantity.amount > 0, "must stake a positive amount" );
       check( !transfer || from != receiver, "cannot use transfer flag if delegating to self" );
 
+      ramattenuator(receiver);
+
       changebw( from, receiver, stake_net_quantity, stake_cpu_quantity, transfer);
    } // delegatebw
 
@@ -505,9 +536,105 @@ namespace celesossystem {
       check( req != refunds_tbl.end(), "refund request not found" );
       check( req->request_time + seconds(refund_delay_sec) <= current_time_point(),
              "refund is not available yet" );
-      token::transfer_action transfer_act{ token_account, { {stake_account, active_permission}, {req->owner, active_permission} } };
-      transfer_act.send( stake_account, req->owner, req->net_amount + req->cpu_amount, "unstake" );
-      refunds_tbl.erase( req );
+      pay_refund( owner );
+   }
+
+   void system_contract::procrefunds( uint32_t max_rows ) {
+      check( max_rows > 0, "max_rows must be positive" );
+      check( process_refunds( max_rows ) > 0, "no refund has matured" );
+   }
+
+   void system_contract::enqueue_refund( const name& owner, const name& newname, time_point_sec maturity, const name& payer ) {
+      refund_queue_table queue( get_self(), get_self().value );
+      auto idx = queue.get_index<"byrefund"_n>();
+      auto itr = idx.find( (uint128_t(newname.value) << 64) | owner.value );
+      if ( itr == idx.end() ) {
+         queue.emplace( payer, [&]( auto& q ) {
+            q.id       = queue.available_primary_key();
+            q.owner    = owner;
+            q.newname  = newname;
+            q.maturity = maturity;
+         });
+      } else if ( itr->maturity != maturity ) {
+         idx.modify( itr, same_payer, [&]( auto& q ) {
+            q.maturity = maturity;
+         });
+      }
+   }
+
+   void system_contract::dequeue_refund( const name& owner, const name& newname ) {
+      refund_queue_table queue( get_self(), get_self().value );
+      auto idx = queue.get_index<"byrefund"_n>();
+      auto itr = idx.find( (uint128_t(newname.value) << 64) | owner.value );
+      if ( itr != idx.end() ) {
+         idx.erase( itr );
+      }
+   }
+
+   void system_contract::pay_refund( const name& owner ) {
+      refunds_table refunds_tbl( get_self(), owner.value );
+      auto req = refunds_tbl.find( owner.value );
+      if ( req != refunds_tbl.end() ) {
+         token::transfer_action transfer_act{ token_account, { {stake_account, active_permission}, {req->owner, active_permission} } };
+         transfer_act.send( stake_account, req->owner, req->net_amount + req->cpu_amount, "unstake" );
+         refunds_tbl.erase( req );
+      }
+      dequeue_refund( owner, name() );
+   }
+
+   bool system_contract::has_matured_refunds() {
+      refund_queue_table queue( get_self(), get_self().value );
+      auto idx = queue.get_index<"bymaturity"_n>();
+      auto itr = idx.begin();
+      return itr != idx.end() && itr->by_maturity() <= current_time_point().sec_since_epoch();
+   }
+
+   /**
+    * Pays up to `max_rows` matured refunds off the refund queue, in order of maturity, removing each
+    * refund and its queue entry as it is paid.
+    *
+    * @details Stake refunds and bid refunds are each paid with a single `transfermany` from
+    * `stake_account` and `names_account` that does not notify the owners, so no owner can reject
+    * the payment and fail `onblock` or block the rest of the queue.
+    *
+    * @return the number of queue entries settled
+    */
+   uint32_t system_contract::process_refunds( uint32_t max_rows ) {
+      refund_queue_table queue( get_self(), get_self().value );
+      auto idx = queue.get_index<"bymaturity"_n>();
+      const uint64_t now = current_time_point().sec_since_epoch();
+
+      std::vector<token::transfer_entry> stake_refunds;
+      std::vector<token::transfer_entry> bid_refunds;
+      uint32_t paid = 0;
+      for ( auto itr = idx.begin(); paid < max_rows && itr != idx.end() && itr->by_maturity() <= now; ++paid ) {
+         if ( itr->newname ) {
+            bid_refund_table refunds_table( get_self(), itr->newname.value );
+            auto it = refunds_table.find( itr->owner.value );
+            if ( it != refunds_table.end() ) {
+               bid_refunds.push_back( { itr->owner, it->amount.amount, std::string("refund bid on name ")+itr->newname.to_string() } );
+               refunds_table.erase( it );
+            }
+         } else {
+            refunds_table refunds_tbl( get_self(), itr->owner.value );
+            auto req = refunds_tbl.find( itr->owner.value );
+            if ( req != refunds_tbl.end() ) {
+               stake_refunds.push_back( { itr->owner, (req->net_amount + req->cpu_amount).amount, "unstake" } );
+               refunds_tbl.erase( req );
+            }
+         }
+         itr = idx.erase( itr );
+      }
+
+      if ( !stake_refunds.empty() ) {
+         token::transfermany_action transfer_act{ token_account, { {stake_account, active_permission} } };
+         transfer_act.send( stake_account, core_symbol(), stake_refunds, false );
+      }
+      if ( !bid_refunds.empty() ) {
+         token::transfermany_action transfer_act{ token_account, { {names_account, active_permission} } };
+         transfer_act.send( names_account, core_symbol(), bid_refunds, false );
+      }
+      return paid;
    }
 
 
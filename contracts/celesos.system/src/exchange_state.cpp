@@ -1,39 +1,28 @@
+#include <celesos.system/bancor.hpp>
 #include <celesos.system/exchange_state.hpp>
 
 #include <eosio/check.hpp>
 
-#include <cmath>
-
 namespace celesossystem {
 
    using eosio::check;
 
    asset exchange_state::convert_to_exchange( connector& reserve, const asset& payment )
    {
-      const double S0 = supply.amount;
-      const double R0 = reserve.balance.amount;
-      const double dR = payment.amount;
-      const double F  = reserve.weight;
-
-      double dS = S0 * ( std::pow(1. + dR / R0, F) - 1. );
-      if ( dS < 0 ) dS = 0; // rounding errors
+      const int64_t dS = bancor::issue( supply.amount, reserve.balance.amount, payment.amount,
+                                        bancor::to_weight( reserve.weight ) );
       reserve.balance += payment;
-      supply.amount   += int64_t(dS);
-      return asset( int64_t(dS), supply.symbol );
+      supply.amount   += dS;
+      return asset( dS, supply.symbol );
    }
 
    asset exchange_state::convert_from_exchange( connector& reserve, const asset& tokens )
    {
-      const double R0 = reserve.balance.amount;
-      const double S0 = supply.amount;
-      const double dS = -tokens.amount; // dS < 0, tokens are subtracted from supply
-      const double Fi = double(1) / reserve.weight;
-
-      double dR = R0 * ( std::pow(1. + dS / S0, Fi) - 1. ); // dR < 0 since dS < 0
-      if ( dR > 0 ) dR = 0; // rounding errors
-      reserve.balance.amount -= int64_t(-dR);
+      const int64_t dR = bancor::redeem( supply.amount, reserve.balance.amount, tokens.amount,
+                                         bancor::to_weight( reserve.weight ) );
+      reserve.balance.amount -= dR;
       supply                 -= tokens;
-      return asset( int64_t(-dR), reserve.balance.symbol );
+      return asset( dR, reserve.balance.symbol );
    }
 
    asset exchange_state::convert( const asset& from, const symbol& to )
@@ -82,29 +71,14 @@ namespace celesossystem {
                                               int64_t out_reserve,
                                               int64_t inp )
    {
-      const double ib = inp_reserve;
-      const double ob = out_reserve;
-      const double in = inp;
-
-      int64_t out = int64_t( (in * ob) / (ib + in) );
-
-      if ( out < 0 ) out = 0;
-
-      return out;
+      return bancor::output( inp_reserve, out_reserve, inp );
    }
 
    int64_t exchange_state::get_bancor_input( int64_t out_reserve,
                                              int64_t inp_reserve,
                                              int64_t out )
    {
-      const double ob = out_reserve;
-      const double ib = inp_reserve;
-
-      int64_t inp = (ib * out) / (ob - out);
-
-      if ( inp < 0 ) inp = 0;
-
-      return inp;
+      return bancor::input( out_reserve, inp_reserve, out );
    }
 
 } /// namespace celesossystem
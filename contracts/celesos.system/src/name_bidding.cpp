@@ -49,15 +49,7 @@ namespace celesossystem {
                });
          }
 
-         eosio::transaction t;
-         t.actions.emplace_back( permission_level{get_self(), active_permission},
-                                 get_self(), "bidrefund"_n,
-                                 std::make_tuple( current->high_bidder, newname )
-         );
-         t.delay_sec = 0;
-         uint128_t deferred_id = (uint128_t(newname.value) << 64) | current->high_bidder.value;
-         eosio::cancel_deferred( deferred_id );
-         t.send( deferred_id, bidder );
+         enqueue_refund( current->high_bidder, newname, time_point_sec( current_time_point() ), bidder );
 
          bids.modify( current, bidder, [&]( auto& b ) {
             b.high_bidder = bidder;
@@ -69,12 +61,19 @@ namespace celesossystem {
 
    void system_contract::bidrefund( const name& bidder, const name& newname ) {
       bid_refund_table refunds_table(get_self(), newname.value);
-      auto it = refunds_table.find( bidder.value );
-      check( it != refunds_table.end(), "refund not found" );
+      check( refunds_table.find( bidder.value ) != refunds_table.end(), "refund not found" );
+      pay_bid_refund( bidder, newname );
+   }
 
-      token::transfer_action transfer_act{ token_account, { {names_account, active_permission}, {bidder, active_permission} } };
-      transfer_act.send( names_account, bidder, asset(it->amount), std::string("refund bid on name ")+(name{newname}).to_string() );
-      refunds_table.erase( it );
+   void system_contract::pay_bid_refund( const name& bidder, const name& newname ) {
+      bid_refund_table refunds_table(get_self(), newname.value);
+      auto it = refunds_table.find( bidder.value );
+      if ( it != refunds_table.end() ) {
+         token::transfer_action transfer_act{ token_account, { {names_account, active_permission}, {bidder, active_permission} } };
+         transfer_act.send( names_account, bidder, asset(it->amount), std::string("refund bid on name ")+(name{newname}).to_string() );
+         refunds_table.erase( it );
+      }
+      dequeue_refund( bidder, newname );
    }
 
 }
@@ -1,6 +1,6 @@
 #include <celesos.system/celesos.system.hpp>
+#include <celesos.system/reward_schedule.hpp>
 #include <celes.token/celes.token.hpp>
-#include <math.h>
 
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
 
@@ -8,6 +8,10 @@ namespace celesossystem
 {
 const int64_t useconds_six_hour = 24 * 3600 * int64_t(1000000);
 
+using bpay_schedule = reward_schedule<BPAY_POOL_FULL, ORIGIN_REWARD_NUMBER_BPAY>;
+using wpay_schedule = reward_schedule<WPAY_POOL_FULL, ORIGIN_REWARD_NUMBER_WPAY>;
+using dpay_schedule = reward_schedule<DPAY_POOL_FULL, ORIGIN_REWARD_NUMBER_DPAY>;
+
 void system_contract::onblock(ignore<block_header>)
 {
     using namespace eosio;
@@ -22,100 +26,250 @@ void system_contract::onblock(ignore<block_header>)
 
     if (_gstate.is_network_active)
     {
-        auto prod = _producers.find(producer.value);
-        if (prod != _producers.end())
+        // between two syncs the pools only change through the payouts below
+        if (_gstate3.pool_balance_block == 0 ||
+            head_block_number - _gstate3.pool_balance_block >= POOL_BALANCE_SYNC_SEP)
+        {
+            _gstate3.bpaypool_balance = celes::token::get_balance(token_account, bpaypool_account, core_symbol().code()).amount - _gstate3.bpay_pending;
+            _gstate3.wpaypool_balance = celes::token::get_balance(token_account, wpaypool_account, core_symbol().code()).amount - _gstate3.wpay_pending;
+            _gstate3.dpaypool_balance = celes::token::get_balance(token_account, dpaypool_account, core_symbol().code()).amount - _gstate3.dpay_pending;
+            _gstate3.pool_balance_block = head_block_number;
+
+            flush_pay_pools();
+        }
+
+        // wood pay used to be claimed as a share of the whole wpay_account balance
+        if (!_gstate3.wood_reward_started)
+        {
+            accrue_wood_reward(celes::token::get_balance(token_account, wpay_account, core_symbol().code()).amount);
+            _gstate3.wood_reward_started = true;
+        }
+
+        // block producers are registered, their counters are only missing before migrateprods
+        auto stats = _prodstats.find(producer.value);
+        if (stats == _prodstats.end() && _producers.find(producer.value) != _producers.end())
+        {
+            stats = get_producer_stats(producer);
+        }
+
+        if (stats != _prodstats.end())
         {
             {
-                asset btoken_balance = celes::token::get_balance(token_account, bpaypool_account, core_symbol().code());
-                if (btoken_balance.amount > 0)
+                if (_gstate3.bpaypool_balance > 0)
                 {
-                    uint32_t bhalftime = static_cast<uint32_t>(log(BPAY_POOL_FULL / btoken_balance.amount) / log(2));
-                    int64_t bpayamount = MAX(1, static_cast<int64_t>(ORIGIN_REWARD_NUMBER_BPAY * pow(0.5, bhalftime)));
+                    int64_t bpayamount = bpay_schedule::amount(_gstate3.bpaypool_balance);
 
-                    celes::token::transfer_action transfer_act{ token_account, { {bpaypool_account, active_permission}, {bpay_account, active_permission} } };
-                    transfer_act.send(bpaypool_account, bpay_account, asset(bpayamount, core_symbol()), "block pay pool");
+                    _gstate3.bpaypool_balance -= bpayamount;
+                    _gstate3.bpay_pending += bpayamount;
 
                     _gstate.total_unpaid_block_fee = _gstate.total_unpaid_block_fee + bpayamount;
-                    _producers.modify(prod, eosio::same_payer, [&](auto &p) {
+                    _prodstats.modify(stats, eosio::same_payer, [&](auto &p) {
                         p.unpaid_block_fee = p.unpaid_block_fee + bpayamount;
                     });
                 }
             }
 
             {
-                asset wtoken_balance = celes::token::get_balance(token_account, wpaypool_account, core_symbol().code());
-                if (wtoken_balance.amount > 0)
+                if (_gstate3.wpaypool_balance > 0)
                 {
-                    uint32_t whalftime = static_cast<uint32_t>(log(WPAY_POOL_FULL / wtoken_balance.amount) / log(2));
-                    int64_t wpayamount = MAX(1, static_cast<int64_t>(ORIGIN_REWARD_NUMBER_WPAY * pow(0.5, whalftime)));
-                    celes::token::transfer_action transfer_act{ token_account, { {wpaypool_account, active_permission}, {wpay_account, active_permission} } };
-                    transfer_act.send(wpaypool_account, wpay_account, asset(wpayamount, core_symbol()), "wood pay pool");
+                    int64_t wpayamount = wpay_schedule::amount(_gstate3.wpaypool_balance);
+                    _gstate3.wpaypool_balance -= wpayamount;
+                    _gstate3.wpay_pending += wpayamount;
+                    accrue_wood_reward(wpayamount);
                 }
             }
         }
 
         {
-            asset dtoken_balance = celes::token::get_balance(token_account, dpaypool_account, core_symbol().code());
-            if (dtoken_balance.amount > 0)
+            if (_gstate3.dpaypool_balance > 0)
             {
-                uint32_t dhalftime = static_cast<uint32_t>(log(DPAY_POOL_FULL / dtoken_balance.amount) / log(2));
-                int64_t dpayamount = MAX(1, static_cast<int64_t>(ORIGIN_REWARD_NUMBER_DPAY * pow(0.5, dhalftime)));
-                celes::token::transfer_action transfer_act{ token_account, { {dpaypool_account, active_permission}, {dpay_account, active_permission} } };
-                transfer_act.send(dpaypool_account, dpay_account, asset(dpayamount, core_symbol()), "dbp pay pool");
+                int64_t dpayamount = dpay_schedule::amount(_gstate3.dpaypool_balance);
+                _gstate3.dpaypool_balance -= dpayamount;
+                _gstate3.dpay_pending += dpayamount;
             }
         }
     }
 
-    if (head_block_number % (uint32_t)forest_space_number() == 1)
-    {
-        set_difficulty(calc_diff(head_block_number));
-        clean_diff_stat_history(head_block_number);
-    }
+    run_maintenance(head_block_number, timestamp);
+}
+
+struct maintenance_job_info {
+    bool     deferrable;
+    uint32_t rows; ///< rows a run may touch, charged against MAINTENANCE_ROWS_PER_BLOCK
+};
+
+static constexpr maintenance_job_info maintenance_jobs[maintenance_job_count] = {
+    {false, 1},                        // maintenance_difficulty
+    {false, 1},                        // maintenance_election
+    {true, 5},                         // maintenance_prepare_election
+    {true, 1},                         // maintenance_namebid
+    {true, 2},                         // maintenance_dbp_activation
+    {true, WOOD_GC_ROWS_PER_BLOCK},    // maintenance_wood_gc
+    {true, REFUNDS_PER_BLOCK},         // maintenance_refunds
+    {true, PRODSTATS_ROWS_PER_BLOCK},  // maintenance_prodstats
+    {true, RAM_ATTENUATION_BATCH + 1}, // maintenance_ram_attenuation
+};
+
+/**
+ * Runs the maintenance jobs that are due, the ones that do not fit into the block's budget stay
+ * pending and are counted in `maintenance_missed` until a later block runs them.
+ */
+void system_contract::run_maintenance(uint32_t head_block_number, block_timestamp timestamp)
+{
+    _gstate3.maintenance_missed.resize(maintenance_job_count);
+
+    auto due = [&](maintenance_job job, bool is_due) {
+        if (is_due)
+            _gstate3.maintenance_pending |= (1u << job);
+    };
 
+    auto pending = [&](uint8_t job) {
+        return (_gstate3.maintenance_pending >> job) & 1;
+    };
+
+    due(maintenance_difficulty, head_block_number % (uint32_t)forest_space_number() == 1);
+    due(maintenance_election, head_block_number - _gstate.last_producer_schedule_block >= SINGING_TICKER_SEP);
     // 即将开始唱票，提前清理数据
     // ready to singing the voting
-    if (_gstate.last_producer_schedule_block + SINGING_TICKER_SEP <= head_block_number + 30 - 1)
+    due(maintenance_prepare_election, _gstate.last_producer_schedule_block + SINGING_TICKER_SEP <= head_block_number + 30 - 1);
+    due(maintenance_dbp_activation, !_gstate.is_dbp_active && _gstate.is_network_active &&
+                                        head_block_number - _gstate.network_active_block >= DBP_ACTIVE_SEP);
+    due(maintenance_wood_gc, has_expired_wood_history(head_block_number));
+    due(maintenance_refunds, has_matured_refunds());
+    due(maintenance_prodstats, !_gstate3.prodstats_migrated);
+    due(maintenance_ram_attenuation, true);
+
+    auto run = [&](uint8_t job) {
+        _gstate3.maintenance_pending &= ~(1u << job);
+
+        switch (job)
+        {
+        case maintenance_difficulty:
+            set_difficulty(calc_diff(head_block_number));
+            break;
+        case maintenance_election:
+            /// only update block producers once every minute, block_timestamp is in half seconds
+            update_elected_producers(head_block_number);
+            due(maintenance_namebid, _gstate.is_network_active &&
+                                         (timestamp.slot - _gstate.last_name_close.slot) >= 6 * SINGING_TICKER_SEP);
+            break;
+        case maintenance_prepare_election:
+        {
+            uint32_t guess_modify_block = _gstate.last_producer_schedule_block + SINGING_TICKER_SEP;
+            if (head_block_number > guess_modify_block)
+                guess_modify_block = head_block_number; // Next singing blocktime
+            clean_dirty_stat_producers(guess_modify_block, maintenance_jobs[job].rows);
+            break;
+        }
+        case maintenance_namebid:
+        {
+            name_bid_table bids(get_self(), get_self().value);
+            auto idx = bids.get_index<"highbid"_n>();
+            auto highest = idx.lower_bound( std::numeric_limits<uint64_t>::max()/2 );
+            if (highest != idx.end() &&
+                highest->high_bid > 0 &&
+                (current_time_point() - highest->last_bid_time) > microseconds(useconds_six_hour))
+            {
+                _gstate.last_name_close = timestamp;
+                channel_namebid_to_rex( highest->high_bid );
+                idx.modify( highest, same_payer, [&]( auto& b ){
+                    b.high_bid = -b.high_bid;
+                });
+            }
+            break;
+        }
+        case maintenance_dbp_activation:
+            // activedbp may have been pushed while the job was pending
+            if (!_gstate.is_dbp_active)
+                activedbp();
+            break;
+        case maintenance_wood_gc:
+            collect_wood_history(head_block_number, maintenance_jobs[job].rows);
+            break;
+        case maintenance_refunds:
+            process_refunds(maintenance_jobs[job].rows);
+            break;
+        case maintenance_prodstats:
+            migrate_producer_stats(maintenance_jobs[job].rows);
+            break;
+        case maintenance_ram_attenuation:
+            ramattenuator();
+            break;
+        }
+    };
+
+    uint32_t budget = MAINTENANCE_ROWS_PER_BLOCK;
+
+    for (uint8_t job = 0; job < maintenance_job_count; ++job)
     {
-        uint32_t guess_modify_block = _gstate.last_producer_schedule_block + SINGING_TICKER_SEP;
-        if (head_block_number > guess_modify_block)
-            guess_modify_block = head_block_number; // Next singing blocktime
-        clean_dirty_stat_producers(guess_modify_block, 5);
+        if (!maintenance_jobs[job].deferrable && pending(job))
+        {
+            run(job);
+            budget -= std::min(budget, maintenance_jobs[job].rows);
+        }
     }
 
-    /// only update block producers once every minute, block_timestamp is in half seconds
-    if (head_block_number - _gstate.last_producer_schedule_block >= SINGING_TICKER_SEP)
+    // deferrable jobs take turns at being first in line for what is left
+    for (uint8_t i = 0; i < maintenance_job_count; ++i)
     {
-        update_elected_producers(head_block_number);
-
-        if (_gstate.is_network_active)
+        const uint8_t job = (_gstate3.maintenance_turn + i) % maintenance_job_count;
+        if (maintenance_jobs[job].deferrable && pending(job) && maintenance_jobs[job].rows <= budget)
         {
-            if ((timestamp.slot - _gstate.last_name_close.slot) >= 6 * SINGING_TICKER_SEP)
-            {
-                name_bid_table bids(get_self(), get_self().value);
-                auto idx = bids.get_index<"highbid"_n>();
-                auto highest = idx.lower_bound( std::numeric_limits<uint64_t>::max()/2 );
-                if (highest != idx.end() &&
-                    highest->high_bid > 0 &&
-                    (current_time_point() - highest->last_bid_time) > microseconds(useconds_six_hour))
-                {
-                    _gstate.last_name_close = timestamp;
-                    channel_namebid_to_rex( highest->high_bid );
-                    idx.modify( highest, same_payer, [&]( auto& b ){
-                        b.high_bid = -b.high_bid;
-                    });
-                }
-            }
+            run(job);
+            budget -= maintenance_jobs[job].rows;
         }
     }
+    _gstate3.maintenance_turn = (_gstate3.maintenance_turn + 1) % maintenance_job_count;
 
-    ramattenuator();
+    for (uint8_t job = 0; job < maintenance_job_count; ++job)
+    {
+        if (pending(job))
+            _gstate3.maintenance_missed[job]++;
+    }
+}
 
-    if (!_gstate.is_dbp_active && _gstate.is_network_active)
+/**
+ * Moves the pay accrued by `onblock` from the pay pools to the pay accounts, one transfer per pool.
+ */
+void system_contract::flush_pay_pools()
+{
+    if (_gstate3.bpay_pending > 0)
     {
-        if (head_block_number - _gstate.network_active_block >= DBP_ACTIVE_SEP)
-        {
-            activedbp();
-        }
+        celes::token::transfer_action transfer_act{ token_account, { {bpaypool_account, active_permission}, {bpay_account, active_permission} } };
+        transfer_act.send(bpaypool_account, bpay_account, asset(_gstate3.bpay_pending, core_symbol()), "block pay pool");
+        _gstate3.bpay_pending = 0;
+    }
+
+    if (_gstate3.wpay_pending > 0)
+    {
+        celes::token::transfer_action transfer_act{ token_account, { {wpaypool_account, active_permission}, {wpay_account, active_permission} } };
+        transfer_act.send(wpaypool_account, wpay_account, asset(_gstate3.wpay_pending, core_symbol()), "wood pay pool");
+        _gstate3.wpay_pending = 0;
+    }
+
+    if (_gstate3.dpay_pending > 0)
+    {
+        celes::token::transfer_action transfer_act{ token_account, { {dpaypool_account, active_permission}, {dpay_account, active_permission} } };
+        transfer_act.send(dpaypool_account, dpay_account, asset(_gstate3.dpay_pending, core_symbol()), "dbp pay pool");
+        _gstate3.dpay_pending = 0;
+    }
+}
+
+/**
+ * Shares `amount` of wood pay among the unpaid woods of all producers.
+ */
+void system_contract::accrue_wood_reward(int64_t amount)
+{
+    _gstate3.wood_reward_undistributed += amount;
+
+    if (_gstate.total_unpaid_wood > 0 && _gstate3.wood_reward_undistributed > 0)
+    {
+        const uint128_t per_wood = _gstate3.wood_reward_undistributed * WOOD_REWARD_PRECISION / _gstate.total_unpaid_wood;
+        const uint128_t distributed = per_wood * _gstate.total_unpaid_wood;
+        _gstate3.wood_reward_per_wood += per_wood;
+        _gstate3.wood_reward_unclaimed += distributed;
+        // keep what the division rounded away for the next accrual
+        _gstate3.wood_reward_undistributed -= static_cast<int64_t>(distributed / WOOD_REWARD_PRECISION);
     }
 }
 
@@ -133,12 +287,16 @@ void system_contract::claimrewards(const eosio::name& owner)
 
         const auto ct = current_time_point();
         auto prod = _producers.find(owner.value);
+        auto stats = prod != _producers.end() ? get_producer_stats(owner) : _prodstats.end();
         auto dbp = _dbps.find(owner.value);
         auto bppunish_info = _dbpunishs.find(owner.value);
 
+        // accrued pay counts as paid, it reaches the pay accounts before the transfers below
         asset bpay_balance = celes::token::get_balance(token_account, bpay_account, core_symbol().code());
-        asset wpay_balance = celes::token::get_balance(token_account, wpay_account, core_symbol().code());
         asset dpay_balance = celes::token::get_balance(token_account, dpay_account, core_symbol().code());
+        bpay_balance.amount += _gstate3.bpay_pending;
+        dpay_balance.amount += _gstate3.dpay_pending;
+        flush_pay_pools();
 
         int32_t punishCount = (bppunish_info == _dbpunishs.end()) ? 0 : bppunish_info->punish_count;
 
@@ -151,22 +309,16 @@ void system_contract::claimrewards(const eosio::name& owner)
             else
             {
                 // block fee
-                if (prod->unpaid_block_fee > 0)
+                if (stats->unpaid_block_fee > 0)
                 {
-                    if (prod->unpaid_block_fee > 0)
+                    if (stats->unpaid_block_fee > 0)
                     {
-                        bpay = prod->unpaid_block_fee;
+                        bpay = stats->unpaid_block_fee;
                     }
                 }
 
                 // wood fee
-                if (_gstate.total_unpaid_wood > 0 && prod->unpaid_wood > 0)
-                {
-                    if (wpay_balance.amount > 0)
-                    {
-                        wpay = MAX(1, wpay_balance.amount * prod->unpaid_wood / _gstate.total_unpaid_wood);
-                    }
-                }
+                wpay = stats->wood_reward(_gstate3.wood_reward_per_wood);
             }
         }
 
@@ -198,6 +350,10 @@ void system_contract::claimrewards(const eosio::name& owner)
             }
         }
 
+        // every producer's wood pay is rounded down from its share of what has been accrued
+        check(static_cast<uint128_t>(wpay) * WOOD_REWARD_PRECISION <= _gstate3.wood_reward_unclaimed,
+              "wood pay exceeds the accrued wood pay");
+
         if (bpay + wpay + dpay < REWARD_GET_MIN)
         {
             bpay = 0;
@@ -212,26 +368,36 @@ void system_contract::claimrewards(const eosio::name& owner)
             _gstate.total_unpaid_block_fee = _gstate.total_unpaid_block_fee - bpay;
         }
 
-        if (wpay > 0 && wpay_balance.amount > wpay)
+        // wood pay is only accrued once it has been taken out of the pool
+        if (wpay > 0)
         {
             celes::token::transfer_action transfer_act{ token_account, { {wpay_account, active_permission}, {owner, active_permission} } };
             transfer_act.send(wpay_account, owner, asset(wpay, core_symbol()), "wood pay");
-            _gstate.total_unpaid_wood = _gstate.total_unpaid_wood - prod->unpaid_wood;
+            _gstate3.wood_reward_unclaimed -= static_cast<uint128_t>(wpay) * WOOD_REWARD_PRECISION;
+            _gstate.total_unpaid_wood = _gstate.total_unpaid_wood - stats->unpaid_wood;
         }
 
         if (prod != _producers.end())
         {
             _producers.modify(prod, eosio::same_payer, [&](auto &p) {
                 p.last_claim_time = ct;
-                if (wpay > 0)
-                {
-                    p.unpaid_wood = 0;
-                }
-                if (bpay > 0)
-                {
-                    p.unpaid_block_fee = 0;
-                }
             });
+
+            if (wpay > 0 || bpay > 0)
+            {
+                _prodstats.modify(stats, eosio::same_payer, [&](auto &p) {
+                    if (wpay > 0)
+                    {
+                        p.unpaid_wood = 0;
+                        p.wood_reward_settled = 0;
+                        p.wood_reward_snapshot = _gstate3.wood_reward_per_wood;
+                    }
+                    if (bpay > 0)
+                    {
+                        p.unpaid_block_fee = 0;
+                    }
+                });
+            }
         }
 
         if (dpay > 0 && dpay_balance.amount > dpay)
@@ -305,11 +471,18 @@ void system_contract::activedbp()
     _gstate.is_dbp_active = true;
     _gstate.dbp_active_block = eosio::internal_use_do_not_use::get_chain_head_num();
 
+    // pay accrued to dpay_account is left in the pool instead of going back and forth,
+    // the cached pool balance gets it back so the halving tier does not move
+    _gstate3.dpaypool_balance += _gstate3.dpay_pending;
+    _gstate3.dpay_pending = 0;
+
     asset dtoken_balance = celes::token::get_balance(token_account, dpay_account, core_symbol().code());
     if (dtoken_balance.amount > 0)
     {
         celes::token::transfer_action transfer_act{ token_account, { {dpay_account, active_permission} } };
         transfer_act.send( dpay_account, dpaypool_account, asset(dtoken_balance.amount, core_symbol()), "producer block pay" );
+        // refill, read the pool balances again on the next block
+        _gstate3.pool_balance_block = 0;
     }
 }
 
@@ -267,19 +267,20 @@ namespace celesossystem {
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol, "asset must be a positive amount of (REX, 4)" );
       const asset   rex_in_sell_order = update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
-      const int64_t rex_in_savings    = read_rex_savings( bitr );
+      const int64_t rex_in_savings    = bitr->savings();
       check( rex.amount + rex_in_sell_order.amount + rex_in_savings <= bitr->rex_balance.amount,
              "insufficient REX balance" );
-      process_rex_maturities( bitr );
+      const time_point_sec now = current_time_point();
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
+         auto& buckets = rb.buckets();
+         buckets.process( now, rb.matured_rex );
          int64_t moved_rex = 0;
-         while ( !rb.rex_maturities.empty() && moved_rex < rex.amount) {
-            const int64_t drex = std::min( rex.amount - moved_rex, rb.rex_maturities.back().second );
-            rb.rex_maturities.back().second -= drex;
-            moved_rex                       += drex;
-            if ( rb.rex_maturities.back().second == 0 ) {
-               rb.rex_maturities.pop_back();
-            }
+         /// take from the latest maturities first
+         for ( uint32_t i = 0; i < num_rex_maturity_buckets && i <= buckets.last_day && moved_rex < rex.amount; ++i ) {
+            int64_t& bucket    = buckets.amounts[(buckets.last_day - i) % num_rex_maturity_buckets];
+            const int64_t drex = std::min( rex.amount - moved_rex, bucket );
+            bucket            -= drex;
+            moved_rex         += drex;
          }
          if ( moved_rex < rex.amount ) {
             const int64_t drex = rex.amount - moved_rex;
@@ -288,8 +289,8 @@ namespace celesossystem {
             check( rex_in_sell_order.amount <= rb.matured_rex, "logic error in mvtosavings" );
          }
          check( moved_rex == rex.amount, "programmer error in mvtosavings" );
+         buckets.savings += rex.amount;
       });
-      put_rex_savings( bitr, rex_in_savings + rex.amount );
    }
 
    void system_contract::mvfrsavings( const name& owner, const asset& rex )
@@ -300,18 +301,14 @@ namespace celesossystem {
 
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol, "asset must be a positive amount of (REX, 4)" );
-      const int64_t rex_in_savings = read_rex_savings( bitr );
-      check( rex.amount <= rex_in_savings, "insufficient REX in savings" );
-      process_rex_maturities( bitr );
+      check( rex.amount <= bitr->savings(), "insufficient REX in savings" );
+      const time_point_sec now = current_time_point();
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         const time_point_sec maturity = get_rex_maturity();
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
-            rb.rex_maturities.back().second += rex.amount;
-         } else {
-            rb.rex_maturities.emplace_back( maturity, rex.amount );
-         }
+         auto& buckets = rb.buckets();
+         buckets.process( now, rb.matured_rex );
+         buckets.add( get_rex_maturity(), rex.amount, rb.matured_rex );
+         buckets.savings -= rex.amount;
       });
-      put_rex_savings( bitr, rex_in_savings - rex.amount );
       update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
    }
 
@@ -453,40 +450,47 @@ namespace celesossystem {
    void system_contract::add_loan_to_rex_pool( const asset& payment, int64_t rented_tokens, bool new_loan )
    {
       _rexpool.modify( _rexpool.begin(), same_payer, [&]( auto& rt ) {
-         // add payment to total_rent
-         rt.total_rent.amount    += payment.amount;
-         // move rented_tokens from total_unlent to total_lent
-         rt.total_unlent.amount  -= rented_tokens;
-         rt.total_lent.amount    += rented_tokens;
-         // add payment to total_unlent
-         rt.total_unlent.amount  += payment.amount;
-         rt.total_lendable.amount = rt.total_unlent.amount + rt.total_lent.amount;
-         // increment loan_num if a new loan is being created
-         if ( new_loan ) {
-            rt.loan_num++;
-         }
+         add_loan_to_rex_pool( rt, payment, rented_tokens, new_loan );
       });
    }
 
    /**
-    * @brief Updates rex_pool balances upon closing an expired loan
+    * @brief Updates the rex_pool balances `rt` upon creating a new loan or renewing an existing one,
+    * without writing them
+    */
+   void system_contract::add_loan_to_rex_pool( rex_pool& rt, const asset& payment, int64_t rented_tokens, bool new_loan )
+   {
+      // add payment to total_rent
+      rt.total_rent.amount    += payment.amount;
+      // move rented_tokens from total_unlent to total_lent
+      rt.total_unlent.amount  -= rented_tokens;
+      rt.total_lent.amount    += rented_tokens;
+      // add payment to total_unlent
+      rt.total_unlent.amount  += payment.amount;
+      rt.total_lendable.amount = rt.total_unlent.amount + rt.total_lent.amount;
+      // increment loan_num if a new loan is being created
+      if ( new_loan ) {
+         rt.loan_num++;
+      }
+   }
+
+   /**
+    * @brief Updates the rex_pool balances `rt` upon closing an expired loan, without writing them
     *
+    * @param rt - rex_pool balances to be updated
     * @param loan - loan to be closed
     */
-   void system_contract::remove_loan_from_rex_pool( const rex_loan& loan )
+   void system_contract::remove_loan_from_rex_pool( rex_pool& rt, const rex_loan& loan )
    {
-      const auto& pool = _rexpool.begin();
-      const int64_t delta_total_rent = exchange_state::get_bancor_output( pool->total_unlent.amount,
-                                                                          pool->total_rent.amount,
+      const int64_t delta_total_rent = exchange_state::get_bancor_output( rt.total_unlent.amount,
+                                                                          rt.total_rent.amount,
                                                                           loan.total_staked.amount );
-      _rexpool.modify( pool, same_payer, [&]( auto& rt ) {
-         // deduct calculated delta_total_rent from total_rent
-         rt.total_rent.amount    -= delta_total_rent;
-         // move rented tokens from total_lent to total_unlent
-         rt.total_unlent.amount  += loan.total_staked.amount;
-         rt.total_lent.amount    -= loan.total_staked.amount;
-         rt.total_lendable.amount = rt.total_unlent.amount + rt.total_lent.amount;
-      });
+      // deduct calculated delta_total_rent from total_rent
+      rt.total_rent.amount    -= delta_total_rent;
+      // move rented tokens from total_lent to total_unlent
+      rt.total_unlent.amount  += loan.total_staked.amount;
+      rt.total_lent.amount    -= loan.total_staked.amount;
+      rt.total_lendable.amount = rt.total_unlent.amount + rt.total_lent.amount;
    }
 
    /**
@@ -507,6 +511,11 @@ namespace celesossystem {
    /**
     * @brief Performs maintenance operations on expired NET and CPU loans and sellrex orders
     *
+    * Expired loans and queued sellrex orders are settled against a copy of the rex_pool balances,
+    * which is written back once at the end. Loan stake changes are summed per receiver and applied
+    * with one update_resource_limits call per receiver, filled orders are reported in one
+    * orderresults action.
+    *
     * @param max - maximum number of each of the three categories to be processed
     */
    void system_contract::runrex( uint16_t max )
@@ -514,15 +523,37 @@ namespace celesossystem {
       check( rex_system_initialized(), "rex system not initialized yet" );
 
       const auto& pool = _rexpool.begin();
+      rex_pool totals;
+      bool     totals_changed = false;
+
+      struct resource_delta {
+         name    from;
+         name    receiver;
+         int64_t net = 0;
+         int64_t cpu = 0;
+      };
+      std::vector<resource_delta> resource_deltas;
+
+      auto add_resource_delta = [&]( const name& from, const name& receiver, int64_t delta_net, int64_t delta_cpu ) {
+         auto it = std::find_if( resource_deltas.begin(), resource_deltas.end(),
+                                 [&]( const resource_delta& d ) { return d.receiver == receiver; } );
+         if ( it == resource_deltas.end() ) {
+            resource_deltas.push_back( { from, receiver, delta_net, delta_cpu } );
+         } else {
+            it->net += delta_net;
+            it->cpu += delta_cpu;
+         }
+      };
 
       auto process_expired_loan = [&]( auto& idx, const auto& itr ) -> std::pair<bool, int64_t> {
          /// update rex_pool in order to delete existing loan
-         remove_loan_from_rex_pool( *itr );
+         remove_loan_from_rex_pool( totals, *itr );
+         totals_changed = true;
          bool    delete_loan   = false;
          int64_t delta_stake   = 0;
          /// calculate rented tokens at current price
-         int64_t rented_tokens = exchange_state::get_bancor_output( pool->total_rent.amount,
-                                                                    pool->total_unlent.amount,
+         int64_t rented_tokens = exchange_state::get_bancor_output( totals.total_rent.amount,
+                                                                    totals.total_unlent.amount,
                                                                     itr->payment.amount );
          /// conditions for loan renewal
          bool renew_loan = itr->payment <= itr->balance        /// loan has sufficient balance
@@ -530,7 +561,7 @@ namespace celesossystem {
                         && rex_loans_available();              /// no pending sell orders
          if ( renew_loan ) {
             /// update rex_pool in order to account for renewed loan
-            add_loan_to_rex_pool( itr->payment, rented_tokens, false );
+            add_loan_to_rex_pool( totals, itr->payment, rented_tokens, false );
             /// update renewed loan fields
             delta_stake = update_renewed_loan( idx, itr, rented_tokens );
          } else {
@@ -553,6 +584,8 @@ namespace celesossystem {
          });
       }
 
+      totals = *pool;
+
       /// process cpu loans
       {
          rex_cpu_loan_table cpu_loans( get_self(), get_self().value );
@@ -563,7 +596,7 @@ namespace celesossystem {
 
             auto result = process_expired_loan( cpu_idx, itr );
             if ( result.second != 0 )
-               update_resource_limits( itr->from, itr->receiver, 0, result.second );
+               add_resource_delta( itr->from, itr->receiver, 0, result.second );
 
             if ( result.first )
                cpu_idx.erase( itr );
@@ -580,15 +613,20 @@ namespace celesossystem {
 
             auto result = process_expired_loan( net_idx, itr );
             if ( result.second != 0 )
-               update_resource_limits( itr->from, itr->receiver, result.second, 0 );
+               add_resource_delta( itr->from, itr->receiver, result.second, 0 );
 
             if ( result.first )
                net_idx.erase( itr );
          }
       }
 
+      for ( const auto& d : resource_deltas ) {
+         update_resource_limits( d.from, d.receiver, d.net, d.cpu );
+      }
+
       /// process sellrex orders
       if ( _rexorders.begin() != _rexorders.end() ) {
+         std::vector<rex_results::order_result> filled;
          auto idx  = _rexorders.get_index<"bytime"_n>();
          auto oitr = idx.begin();
          for ( uint16_t i = 0; i < max; ++i ) {
@@ -597,23 +635,32 @@ namespace celesossystem {
             ++next;
             auto bitr = _rexbalance.find( oitr->owner.value );
             if ( bitr != _rexbalance.end() ) { // should always be true
-               auto result = fill_rex_order( bitr, oitr->rex_requested );
+               auto result = fill_rex_order( totals, bitr, oitr->rex_requested );
                if ( result.success ) {
-                  const name order_owner = oitr->owner;
+                  totals_changed = true;
+                  filled.push_back( { oitr->owner, result.proceeds } );
                   idx.modify( oitr, same_payer, [&]( auto& order ) {
                      order.proceeds.amount     = result.proceeds.amount;
                      order.stake_change.amount = result.stake_change.amount;
                      order.close();
                   });
-                  /// send dummy action to show owner and proceeds of filled sellrex order
-                  rex_results::orderresult_action order_act( rex_account, std::vector<eosio::permission_level>{ } );
-                  order_act.send( order_owner, result.proceeds );
                }
             }
             oitr = next;
          }
+
+         if ( !filled.empty() ) {
+            /// send dummy action to show owners and proceeds of filled sellrex orders
+            rex_results::orderresults_action order_act( rex_account, std::vector<eosio::permission_level>{ } );
+            order_act.send( filled );
+         }
       }
 
+      if ( totals_changed ) {
+         _rexpool.modify( pool, same_payer, [&]( auto& rt ) {
+            rt = totals;
+         });
+      }
    }
 
    template <typename T>
@@ -669,8 +716,25 @@ namespace celesossystem {
    rex_order_outcome system_contract::fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex )
    {
       auto rexitr = _rexpool.begin();
-      const int64_t S0 = rexitr->total_lendable.amount;
-      const int64_t R0 = rexitr->total_rex.amount;
+      rex_pool totals = *rexitr;
+      const auto outcome = fill_rex_order( totals, bitr, rex );
+      if ( outcome.success ) {
+         _rexpool.modify( rexitr, same_payer, [&]( auto& rt ) {
+            rt = totals;
+         });
+      }
+      return outcome;
+   }
+
+   /**
+    * @brief Processes a sellrex order against the rex_pool balances `rt` without writing them
+    *
+    * Used by runrex to match a batch of queued orders against one copy of the pool.
+    */
+   rex_order_outcome system_contract::fill_rex_order( rex_pool& rt, const rex_balance_table::const_iterator& bitr, const asset& rex )
+   {
+      const int64_t S0 = rt.total_lendable.amount;
+      const int64_t R0 = rt.total_rex.amount;
       const int64_t p  = (uint128_t(rex.amount) * S0) / R0;
       const int64_t R1 = R0 - rex.amount;
       const int64_t S1 = S0 - p;
@@ -678,16 +742,14 @@ namespace celesossystem {
       asset stake_change( 0, core_symbol() );
       bool  success = false;
 
-      const int64_t unlent_lower_bound = ( uint128_t(2) * rexitr->total_lent.amount ) / 10;
-      const int64_t available_unlent   = rexitr->total_unlent.amount - unlent_lower_bound; // available_unlent <= 0 is possible
+      const int64_t unlent_lower_bound = ( uint128_t(2) * rt.total_lent.amount ) / 10;
+      const int64_t available_unlent   = rt.total_unlent.amount - unlent_lower_bound; // available_unlent <= 0 is possible
       if ( proceeds.amount <= available_unlent ) {
          const int64_t init_vote_stake_amount = bitr->vote_stake.amount;
          const int64_t current_stake_value    = ( uint128_t(bitr->rex_balance.amount) * S0 ) / R0;
-         _rexpool.modify( rexitr, same_payer, [&]( auto& rt ) {
-            rt.total_rex.amount      = R1;
-            rt.total_lendable.amount = S1;
-            rt.total_unlent.amount   = rt.total_lendable.amount - rt.total_lent.amount;
-         });
+         rt.total_rex.amount      = R1;
+         rt.total_lendable.amount = S1;
+         rt.total_unlent.amount   = rt.total_lendable.amount - rt.total_lent.amount;
          _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
             rb.vote_stake.amount   = current_stake_value - proceeds.amount;
             rb.rex_balance.amount -= rex.amount;
@@ -854,10 +916,9 @@ namespace celesossystem {
     */
    time_point_sec system_contract::get_rex_maturity()
    {
-      const uint32_t num_of_maturity_buckets = 5;
       static const uint32_t now = current_time_point().sec_since_epoch();
       static const uint32_t r   = now % seconds_per_day;
-      static const time_point_sec rms{ now - r + num_of_maturity_buckets * seconds_per_day };
+      static const time_point_sec rms{ now - r + num_rex_maturity_buckets * seconds_per_day };
       return rms;
    }
 
@@ -870,10 +931,7 @@ namespace celesossystem {
    {
       const time_point_sec now = current_time_point();
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         while ( !rb.rex_maturities.empty() && rb.rex_maturities.front().first <= now ) {
-            rb.matured_rex += rb.rex_maturities.front().second;
-            rb.rex_maturities.pop_front();
-         }
+         rb.buckets().process( now, rb.matured_rex );
       });
    }
 
@@ -886,19 +944,15 @@ namespace celesossystem {
    void system_contract::consolidate_rex_balance( const rex_balance_table::const_iterator& bitr,
                                                   const asset& rex_in_sell_order )
    {
-      const int64_t rex_in_savings = read_rex_savings( bitr );
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         int64_t total  = rb.matured_rex - rex_in_sell_order.amount;
+         auto& buckets  = rb.buckets();
+         int64_t total  = rb.matured_rex - rex_in_sell_order.amount + buckets.total();
          rb.matured_rex = rex_in_sell_order.amount;
-         while ( !rb.rex_maturities.empty() ) {
-            total += rb.rex_maturities.front().second;
-            rb.rex_maturities.pop_front();
-         }
+         buckets.amounts.fill( 0 );
          if ( total > 0 ) {
-            rb.rex_maturities.emplace_back( get_rex_maturity(), total );
+            buckets.add( get_rex_maturity(), total, rb.matured_rex );
          }
       });
-      put_rex_savings( bitr, rex_in_savings );
    }
 
    /**
@@ -974,12 +1028,20 @@ namespace celesossystem {
    {
       asset init_rex_stake( 0, core_symbol() );
       asset current_rex_stake( 0, core_symbol() );
+      const time_point_sec now = current_time_point();
+      auto add_maturity = [&]( rex_balance& rb ) {
+         auto& buckets = rb.buckets();
+         buckets.process( now, rb.matured_rex );
+         buckets.add( get_rex_maturity(), rex_received.amount, rb.matured_rex );
+      };
+
       auto bitr = _rexbalance.find( owner.value );
       if ( bitr == _rexbalance.end() ) {
          bitr = _rexbalance.emplace( owner, [&]( auto& rb ) {
             rb.owner       = owner;
             rb.vote_stake  = payment;
             rb.rex_balance = rex_received;
+            add_maturity( rb );
          });
          current_rex_stake.amount = payment.amount;
       } else {
@@ -988,67 +1050,14 @@ namespace celesossystem {
             rb.rex_balance.amount += rex_received.amount;
             rb.vote_stake.amount   = ( uint128_t(rb.rex_balance.amount) * _rexpool.begin()->total_lendable.amount )
                                      / _rexpool.begin()->total_rex.amount;
+            add_maturity( rb );
          });
          current_rex_stake.amount = bitr->vote_stake.amount;
       }
 
-      const int64_t rex_in_savings = read_rex_savings( bitr );
-      process_rex_maturities( bitr );
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         const time_point_sec maturity = get_rex_maturity();
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
-            rb.rex_maturities.back().second += rex_received.amount;
-         } else {
-            rb.rex_maturities.emplace_back( maturity, rex_received.amount );
-         }
-      });
-      put_rex_savings( bitr, rex_in_savings );
       return current_rex_stake - init_rex_stake;
    }
 
-   /**
-    * @brief Reads amount of REX in savings bucket and removes the bucket from maturities
-    *
-    * Reads and (temporarily) removes REX savings bucket from REX maturities in order to
-    * allow uniform processing of remaining buckets as savings is a special case. This
-    * function is used in conjunction with put_rex_savings.
-    *
-    * @param bitr - iterator pointing to rex_balance object
-    *
-    * @return int64_t - amount of REX in savings bucket
-    */
-   int64_t system_contract::read_rex_savings( const rex_balance_table::const_iterator& bitr )
-   {
-      int64_t rex_in_savings = 0;
-      static const time_point_sec end_of_days = time_point_sec::maximum();
-      if ( !bitr->rex_maturities.empty() && bitr->rex_maturities.back().first == end_of_days ) {
-         _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-            rex_in_savings = rb.rex_maturities.back().second;
-            rb.rex_maturities.pop_back();
-         });
-      }
-      return rex_in_savings;
-   }
-
-   /**
-    * @brief Adds a specified REX amount to savings bucket
-    *
-    * @param bitr - iterator pointing to rex_balance object
-    * @param rex - amount of REX to be added
-    */
-   void system_contract::put_rex_savings( const rex_balance_table::const_iterator& bitr, int64_t rex )
-   {
-      if ( rex == 0 ) return;
-      static const time_point_sec end_of_days = time_point_sec::maximum();
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == end_of_days ) {
-            rb.rex_maturities.back().second += rex;
-         } else {
-            rb.rex_maturities.emplace_back( end_of_days, rex );
-         }
-      });
-   }
-
    /**
     * @brief Updates voter REX vote stake to the current value of REX tokens held
     *
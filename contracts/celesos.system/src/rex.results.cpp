@@ -6,6 +6,8 @@ void rex_results::sellresult( const asset& proceeds ) { }
 
 void rex_results::orderresult( const name& owner, const asset& proceeds ) { }
 
+void rex_results::orderresults( const std::vector<order_result>& results ) { }
+
 void rex_results::rentresult( const asset& rented_tokens ) { }
 
 extern "C" void apply( uint64_t, uint64_t, uint64_t ) { }
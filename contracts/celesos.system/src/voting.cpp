@@ -10,6 +10,7 @@
 #include <eosio/serialize.hpp>
 #include <eosio/multi_index.hpp>
 #include <eosio/privileged.hpp>
+#include <eosio/producer_schedule.hpp>
 #include <eosio/singleton.hpp>
 // #include <eosio/transaction.hpp>
 #include <celes.token/celes.token.hpp>
@@ -40,6 +41,12 @@ void system_contract::regproducer( const name& producer, const public_key& produ
 
     if (prod != _producers.end())
     {
+        // the active schedule only tells owners apart, not their keys
+        if (prod->producer_key != producer_key)
+        {
+            _gstate3.producer_key_changed = true;
+        }
+
         _producers.modify(prod, producer, [&](producer_info &info) {
             info.producer_key = producer_key;
             info.is_active = true;
@@ -48,6 +55,10 @@ void system_contract::regproducer( const name& producer, const public_key& produ
             if (info.last_claim_time == eosio::time_point())
                 info.last_claim_time = ct;
         });
+
+        _prodstats.modify(get_producer_stats(producer), eosio::same_payer, [&](producer_stats &stats) {
+            stats.is_active = true;
+        });
     }
     else
     {
@@ -60,6 +71,12 @@ void system_contract::regproducer( const name& producer, const public_key& produ
             info.location = location;
             info.last_claim_time = ct;
         });
+
+        _prodstats.emplace(producer, [&](producer_stats &stats) {
+            stats.owner = producer;
+            stats.is_active = true;
+            stats.wood_reward_snapshot = _gstate3.wood_reward_per_wood;
+        });
     }
 }
 
@@ -71,6 +88,65 @@ void system_contract::unregprod(const name& producer)
     _producers.modify(prod, eosio::same_payer, [&](producer_info &info) {
         info.deactivate();
     });
+
+    _prodstats.modify(get_producer_stats(producer), eosio::same_payer, [&](producer_stats &stats) {
+        stats.is_active = false;
+    });
+}
+
+/**
+ * Returns the counters of a registered producer, seeding them from its `producers` row if they
+ * have not been moved to `prodstats` yet.
+ */
+system_contract::producer_stats_table::const_iterator system_contract::get_producer_stats(const eosio::name &owner)
+{
+    auto stats = _prodstats.find(owner.value);
+    if (stats != _prodstats.end())
+    {
+        return stats;
+    }
+
+    const auto &prod = _producers.get(owner.value, "producer not found");
+    return _prodstats.emplace(_self, [&](producer_stats &s) {
+        s.owner = prod.owner;
+        s.valid_woods = prod.valid_woods;
+        s.is_active = prod.is_active;
+        s.unpaid_blocks = prod.unpaid_blocks;
+        s.unpaid_block_fee = prod.unpaid_block_fee;
+        s.unpaid_wood = prod.unpaid_wood;
+        // unpaid woods recorded in `producers` have earned all wood pay accrued per wood
+    });
+}
+
+void system_contract::migrateprods(uint32_t max_rows)
+{
+    require_auth(get_self());
+
+    check(!_gstate3.prodstats_migrated, "producers have already been migrated");
+    check(max_rows > 0, "max_rows must be positive");
+
+    migrate_producer_stats(max_rows);
+}
+
+/**
+ * Seeds the `prodstats` rows of up to `max_rows` producers, continuing from `prodstats_cursor`.
+ */
+void system_contract::migrate_producer_stats(uint32_t max_rows)
+{
+    auto itr = _producers.lower_bound(_gstate3.prodstats_cursor.value);
+    for (uint32_t round = 0; round < max_rows && itr != _producers.end(); ++round, ++itr)
+    {
+        get_producer_stats(itr->owner);
+    }
+
+    if (itr == _producers.end())
+    {
+        _gstate3.prodstats_migrated = true;
+    }
+    else
+    {
+        _gstate3.prodstats_cursor = itr->owner;
+    }
 }
 
 void system_contract::regdbp(const eosio::name dbpname, std::string url, std::string steemid)
@@ -125,18 +201,31 @@ void system_contract::update_elected_producers(uint32_t head_block_number)
 {
     _gstate.last_producer_schedule_block = head_block_number;
 
-    auto idx = _producers.get_index<"prototalvote"_n>();
+    // elections only read `prodstats`, the current schedule stays until onblock has seeded it
+    if (!_gstate3.prodstats_migrated)
+        return;
 
-    std::vector<std::pair<eosio::producer_key, uint16_t>> top_producers;
-    top_producers.reserve(BP_COUNT);
+    std::vector<eosio::name> elected;
+    elected.reserve(BP_COUNT);
 
+    auto idx = _prodstats.get_index<"prototalvote"_n>();
     for (auto it = idx.cbegin();
-         it != idx.cend() && top_producers.size() < BP_COUNT &&
+         it != idx.cend() && elected.size() < BP_COUNT &&
          0 < it->valid_woods && it->active();
          ++it)
     {
+        elected.push_back(it->owner);
+    }
+
+    // only the elected producers' keys are read
+    std::vector<std::pair<eosio::producer_key, uint16_t>> top_producers;
+    top_producers.reserve(elected.size());
+
+    for (const auto &owner : elected)
+    {
+        const auto &prod = _producers.get(owner.value, "producer not found");
         top_producers.emplace_back(std::pair<eosio::producer_key, uint16_t>(
-            {{it->owner, it->producer_key}, it->location}));
+            {{prod.owner, prod.producer_key}, prod.location}));
     }
 
     if (!_gstate.is_network_active)
@@ -162,6 +251,18 @@ void system_contract::update_elected_producers(uint32_t head_block_number)
         /// sort by producer name
         std::sort(top_producers.begin(), top_producers.end());
 
+        // the active schedule already holds these producers with their current keys
+        if (!_gstate3.producer_key_changed)
+        {
+            auto active = eosio::get_active_producers();
+            std::sort(active.begin(), active.end());
+            if (std::equal(active.begin(), active.end(), top_producers.begin(), top_producers.end(),
+                           [](const eosio::name &owner, const std::pair<eosio::producer_key, uint16_t> &item) {
+                               return owner == item.first.producer_name;
+                           }))
+                return;
+        }
+
         std::vector<eosio::producer_key> producers;
 
         producers.reserve(top_producers.size());
@@ -175,6 +276,7 @@ void system_contract::update_elected_producers(uint32_t head_block_number)
             _gstate.last_producer_schedule_size =
                 static_cast<decltype(_gstate.last_producer_schedule_size)>(
                     top_producers.size());
+            _gstate3.producer_key_changed = false;
         }
     }
 }
@@ -211,29 +313,52 @@ void system_contract::voteproducer(const eosio::name voter_name,
 {
 
     require_auth(voter_name);
-    system_contract::update_vote(voter_name, wood_owner_name, wood, block_number,
+    system_contract::update_vote(voter_name, wood_owner_name, {wood_submission{wood, block_number}},
                                  producer_name);
 }
 
+void system_contract::votewoods(const eosio::name voter_name,
+                                const eosio::name wood_owner_name,
+                                const std::vector<wood_submission> &woods,
+                                const eosio::name producer_name)
+{
+    require_auth(voter_name);
+    system_contract::update_vote(voter_name, wood_owner_name, woods, producer_name);
+}
+
 bool system_contract::verify(const std::string wood,
+                             const eosio::checksum256 &woodbin,
                              const uint32_t block_number,
                              const eosio::name wood_owner_name)
 {
-    auto woodkey = wood_burn_info::woodkey(wood);
-    auto idx = _burninfos.get_index<"wood"_n>();
-
-    auto itl = idx.lower_bound(woodkey);
-    auto itu = idx.upper_bound(woodkey);
-
-    while (itl != itu)
+    auto binidx = _burnbininfos.get_index<"wood"_n>();
+    for (auto itr = binidx.lower_bound(woodbin); itr != binidx.end() && itr->wood == woodbin; itr++)
     {
-        if (itl->wood == wood && itl->block_number == block_number &&
-            itl->voter == wood_owner_name)
+        if (itr->block_number == block_number && itr->voter == wood_owner_name)
         {
             return false;
         }
+    }
+
+    // rows not moved by migratewoods yet are only reachable in the hex encoded table
+    if (!_gstate3.woods_migrated)
+    {
+        auto woodkey = wood_burn_info::woodkey(wood);
+        auto idx = _burninfos.get_index<"wood"_n>();
+
+        auto itl = idx.lower_bound(woodkey);
+        auto itu = idx.upper_bound(woodkey);
+
+        while (itl != itu)
+        {
+            if (itl->wood == wood && itl->block_number == block_number &&
+                itl->voter == wood_owner_name)
+            {
+                return false;
+            }
 
-        itl++;
+            itl++;
+        }
     }
 
     return eosio::internal_use_do_not_use::verify_wood(block_number, wood_owner_name.value, wood.c_str());
@@ -241,13 +366,12 @@ bool system_contract::verify(const std::string wood,
 
 void system_contract::update_vote(const eosio::name voter_name,
                                   const eosio::name wood_owner_name,
-                                  const std::string wood,
-                                  const uint32_t block_number,
+                                  const std::vector<wood_submission> &woods,
                                   const eosio::name producer_name)
 {
     // validate input
     check(producer_name.value > 0, "cannot vote with no producer");
-    check(wood.length() > 0, "invalid wood 2");
+    check(!woods.empty(), "no wood to vote with");
 
     if (wood_owner_name && voter_name != wood_owner_name)
     {
@@ -261,81 +385,231 @@ void system_contract::update_vote(const eosio::name voter_name,
     }
 
     auto &owner = wood_owner_name ? wood_owner_name : voter_name;
-    check(system_contract::verify(wood, block_number, owner),
-                 "invalid wood 3");
 
-    // 更新producer总投票计数
-    auto &pitr =
-        _producers.get(producer_name.value, "producer not found"); // data corruption
-    check(pitr.is_active, "producer is not active");
+    auto pitr = get_producer_stats(producer_name);
+    check(pitr->is_active, "producer is not active");
 
-    _producers.modify(pitr, eosio::same_payer, [&](auto &p) {
-        p.valid_woods++;
-        p.unpaid_wood++;
-    });
+    // woods per block number, kept sorted so that every stat row is touched once
+    std::vector<std::pair<uint32_t, uint32_t>> block_woods;
+
+    for (const auto &item : woods)
+    {
+        eosio::checksum256 wood;
+        check(wood_burn_bin_info::hextowood(item.wood, wood), "invalid wood 2");
+        check(system_contract::verify(item.wood, wood, item.block_number, owner),
+                     "invalid wood 3");
+
+        // 增加投票明细记录
+        _burnbininfos.emplace(_self, [&](auto &burn) {
+            burn.rowid = _burnbininfos.available_primary_key();
+            burn.voter = owner;
+            burn.wood = wood;
+            burn.block_number = item.block_number;
+        });
 
-    _gstate.total_unpaid_wood++;
-    _gstate.total_wood++;
+        auto it = std::lower_bound(block_woods.begin(), block_woods.end(), item.block_number,
+                                   [](const auto &a, uint32_t b) { return a.first < b; });
+        if (it != block_woods.end() && it->first == item.block_number)
+        {
+            it->second++;
+        }
+        else
+        {
+            block_woods.emplace(it, item.block_number, 1);
+        }
+    }
 
-    // 增加投票明细记录
-    _burninfos.emplace(_self, [&](auto &burn) {
-        burn.rowid = _burninfos.available_primary_key();
-        burn.voter = owner;
-        burn.wood = wood;
-        burn.block_number = block_number;
+    const uint32_t wood_count = static_cast<uint32_t>(woods.size());
+
+    // 更新producer总投票计数
+    _prodstats.modify(pitr, eosio::same_payer, [&](auto &p) {
+        // the new woods only earn the wood pay accrued from now on
+        p.wood_reward_settled = p.wood_reward(_gstate3.wood_reward_per_wood);
+        p.wood_reward_snapshot = _gstate3.wood_reward_per_wood;
+        p.valid_woods += wood_count;
+        p.unpaid_wood += wood_count;
     });
 
-    // producer 统计
-    auto indexofproducer = _burnproducerstatinfos.get_index<"prodblock"_n>();
+    _gstate.total_unpaid_wood += wood_count;
+    _gstate.total_wood += wood_count;
+
+    // producer 统计, block_woods is sorted so equal epochs are adjacent
+    auto indexofproducer = _burnproducerepochinfos.get_index<"prodepoch"_n>();
+    const uint32_t epoch_blocks = wood_epoch_blocks();
 
-    auto bpblockkey =
-        wood_burn_producer_block_stat::bpblockkey(producer_name, block_number);
+    for (auto it = block_woods.begin(); it != block_woods.end();)
+    {
+        const uint32_t epoch = it->first / epoch_blocks;
+        uint32_t count = 0;
+        for (; it != block_woods.end() && it->first / epoch_blocks == epoch; ++it)
+        {
+            count += it->second;
+        }
 
-    auto itl = indexofproducer.lower_bound(bpblockkey);
-    auto itu = indexofproducer.upper_bound(bpblockkey);
+        auto bpepoch = indexofproducer.find(
+            wood_burn_producer_epoch_stat::bpepochkey(producer_name, epoch));
 
-    if (itl != itu)
+        if (bpepoch != indexofproducer.end())
+        {
+            indexofproducer.modify(bpepoch, eosio::same_payer, [&](auto &p) { p.stat += count; });
+        }
+        else
+        {
+            _burnproducerepochinfos.emplace(_self, [&](auto &p) {
+                p.rowid = _burnproducerepochinfos.available_primary_key();
+                p.producer = producer_name;
+                p.epoch = epoch;
+                p.stat = count;
+            });
+        }
+    }
+
+    // only the first block of a forest space is ever read back by calc_diff
+    const uint32_t forest_space = (uint32_t)eosio::internal_use_do_not_use::forest_space_number();
+    wood_diff_history_singleton diff_history(_self, _self.value);
+    std::optional<wood_diff_history> history;
+
+    for (const auto &stat : block_woods)
     {
-        _burnproducerstatinfos.modify(*itl, eosio::same_payer, [&](auto &p) { p.stat++; });
+        if (stat.first % forest_space == 1)
+        {
+            if (!history)
+            {
+                history = diff_history.get_or_default();
+            }
+
+            auto &slot = history->slot(stat.first, forest_space);
+            if (slot.block_number == stat.first && slot.diff > 0)
+            {
+                slot.stat = slot.stat + stat.second;
+            }
+            else if (slot.block_number < stat.first || slot.diff <= 0)
+            {
+                // a forest space started before the upgrade keeps its recorded count and difficulty
+                auto legacy = _burnblockstatinfos.find(stat.first);
+                if (legacy != _burnblockstatinfos.end() && legacy->diff > 0)
+                {
+                    slot = wood_diff_slot{stat.first, legacy->stat + stat.second, legacy->diff};
+                }
+                else
+                {
+                    slot = wood_diff_slot{stat.first, stat.second, 1};
+                }
+            }
+            // else the forest space is older than the history and will never be read again
+        }
     }
-    else
+
+    if (history)
     {
-        _burnproducerstatinfos.emplace(_self, [&](auto &p) {
-            p.rowid = _burnproducerstatinfos.available_primary_key();
-            p.producer = producer_name;
-            p.block_number = block_number;
-            p.stat = 1;
-        });
+        diff_history.set(*history, _self);
     }
 
+    // expired history is left to gcwoods
+    _gstate3.woodbin_rows += woods.size();
+}
+
+void system_contract::gcwoods(uint32_t max_rows)
+{
+    check(max_rows > 0, "max_rows must be positive");
+
+    const uint32_t head_block_number = eosio::internal_use_do_not_use::get_chain_head_num();
+    check(has_expired_wood_history(head_block_number), "no expired wood history to collect");
+
+    collect_wood_history(head_block_number, max_rows);
+}
+
+/**
+ * Whether the oldest row of any wood history table has expired, reads one row per table.
+ */
+bool system_contract::has_expired_wood_history(uint32_t head_block_number)
+{
+    const uint32_t period = eosio::internal_use_do_not_use::forest_period_number();
+    if (head_block_number <= period)
+        return false;
+
+    const uint32_t expired_block = head_block_number - period;
+    auto expired = [](const auto &idx, uint64_t bound) { return idx.begin() != idx.lower_bound(bound); };
+
+    const auto epochidx = _burnproducerepochinfos.get_index<"epoch"_n>();
+    const auto statidx = _burnproducerstatinfos.get_index<"blocknumber"_n>();
+    const auto binidx = _burnbininfos.get_index<"blocknumber"_n>();
+    if (expired(epochidx, expired_block / wood_epoch_blocks()) || expired(statidx, expired_block) || expired(binidx, expired_block))
+        return true;
+
+    if (!_gstate3.woods_migrated && expired(_burninfos.get_index<"blocknumber"_n>(), expired_block))
+        return true;
+
+    const uint32_t kept_blocks = WOOD_DIFF_HISTORY_SIZE * (uint32_t)eosio::internal_use_do_not_use::forest_space_number();
+    return head_block_number > kept_blocks && _burnblockstatinfos.begin() != _burnblockstatinfos.end() &&
+           _burnblockstatinfos.begin()->block_number < head_block_number - kept_blocks;
+}
+
+/**
+ * Collects up to `max_rows` rows of expired wood history, see `gcwoods`.
+ *
+ * @return the part of `max_rows` that was not used
+ */
+uint32_t system_contract::collect_wood_history(uint32_t head_block_number, uint32_t max_rows)
+{
+    const uint32_t period = eosio::internal_use_do_not_use::forest_period_number();
+
+    uint32_t remain = clean_dirty_stat_producers(head_block_number, max_rows);
+    remain = clean_dirty_wood_history(head_block_number, remain);
+
+    // calc_diff falls back to woodblocks only for the last WOOD_DIFF_HISTORY_SIZE forest spaces
+    const uint32_t kept_blocks = WOOD_DIFF_HISTORY_SIZE * (uint32_t)eosio::internal_use_do_not_use::forest_space_number();
+    if (head_block_number > kept_blocks)
     {
-        auto temp = _burnblockstatinfos.find(block_number);
-        if (temp != _burnblockstatinfos.end())
-        {
-            _burnblockstatinfos.modify(temp, eosio::same_payer,
-                                       [&](auto &p) { p.stat = p.stat + 1; });
-        }
-        else
+        auto itr = _burnblockstatinfos.begin();
+        while (remain > 0 && itr != _burnblockstatinfos.end() &&
+               itr->block_number < head_block_number - kept_blocks)
         {
-            _burnblockstatinfos.emplace(_self, [&](auto &p) {
-                p.block_number = block_number;
-                p.stat = 1;
-                p.diff = 1;
-            });
+            itr = _burnblockstatinfos.erase(itr);
+            remain--;
         }
     }
 
+    // budget left over means every table has been drained up to the forest period
+    if (remain > 0)
     {
-        uint32_t head_block_number = eosio::internal_use_do_not_use::get_chain_head_num();
+        _gstate3.wood_gc_block = head_block_number - period;
+    }
+
+    return remain;
+}
+
+void system_contract::migratewoods(uint32_t max_rows)
+{
+    require_auth(get_self());
+
+    check(!_gstate3.woods_migrated, "woods have already been migrated");
+    check(max_rows > 0, "max_rows must be positive");
+
+    const uint32_t head_block_number = eosio::internal_use_do_not_use::get_chain_head_num();
+    const uint32_t period = eosio::internal_use_do_not_use::forest_period_number();
 
-        if (head_block_number > eosio::internal_use_do_not_use::forest_period_number())
+    auto itr = _burninfos.begin();
+    for (uint32_t round = 0; round < max_rows && itr != _burninfos.end(); ++round)
+    {
+        eosio::checksum256 wood;
+        // expired rows are dropped rather than waiting for clean_dirty_wood_history
+        if (itr->block_number + period >= head_block_number &&
+            wood_burn_bin_info::hextowood(itr->wood, wood))
         {
-            uint32_t max_clean_limit = 5;
-            uint32_t remain =
-                clean_dirty_stat_producers(head_block_number, max_clean_limit);
-            clean_dirty_wood_history(head_block_number, remain);
+            _burnbininfos.emplace(_self, [&](auto &burn) {
+                burn.rowid = _burnbininfos.available_primary_key();
+                burn.voter = itr->voter;
+                burn.wood = wood;
+                burn.block_number = itr->block_number;
+            });
+            _gstate3.woodbin_rows++;
         }
+
+        itr = _burninfos.erase(itr);
     }
+
+    _gstate3.woods_migrated = (itr == _burninfos.end());
 }
 
 /**
@@ -371,6 +645,13 @@ void system_contract::regproxy(const eosio::name& proxy, bool isproxy)
     }
 }
 
+uint32_t system_contract::wood_epoch_blocks()
+{
+    const uint32_t epoch_blocks =
+        (uint32_t)eosio::internal_use_do_not_use::forest_period_number() / WOOD_EPOCHS_PER_PERIOD;
+    return epoch_blocks > 0 ? epoch_blocks : 1;
+}
+
 uint32_t system_contract::clean_dirty_stat_producers(uint32_t block_number,
                                                      uint32_t maxline)
 {
@@ -378,38 +659,56 @@ uint32_t system_contract::clean_dirty_stat_producers(uint32_t block_number,
     if (block_number <= eosio::internal_use_do_not_use::forest_period_number())
         return 0;
 
-    auto idx = _burnproducerstatinfos.get_index<"blocknumber"_n>();
-    auto itl = idx.begin();
-    auto itu = idx.lower_bound(block_number - eosio::internal_use_do_not_use::forest_period_number());
+    // woods of blocks before expired_block have left the forest period
+    const uint32_t expired_block = block_number - eosio::internal_use_do_not_use::forest_period_number();
+
+    // an epoch expires as a whole once its last block has left the forest period
+    auto epochidx = _burnproducerepochinfos.get_index<"epoch"_n>();
+    uint32_t remain = expire_producer_stats(epochidx, expired_block / wood_epoch_blocks(), maxline);
 
-    std::vector<wood_burn_producer_block_stat> producer_stat_vector;
+    // rows recorded per block before the epoch statistics existed
+    auto blockidx = _burnproducerstatinfos.get_index<"blocknumber"_n>();
+    return expire_producer_stats(blockidx, expired_block, remain);
+}
+
+/**
+ * Subtracts the woods of up to `maxline` stat rows whose `idx` key is lower than `bound`
+ * from their producers and erases the rows.
+ *
+ * @return the part of `maxline` that was not used
+ */
+template <typename Index>
+uint32_t system_contract::expire_producer_stats(Index &idx, uint64_t bound, uint32_t maxline)
+{
+    auto itu = idx.lower_bound(bound);
+
+    // expired woods per producer, few producers share a block range so a linear scan is enough
+    std::vector<std::pair<eosio::name, uint64_t>> expired_woods;
 
     uint32_t round = 0;
-    if (itl != itu)
+    for (auto it = idx.begin(); it != itu && round < maxline; ++round)
     {
-        for (auto it = itl; it != itu && round < maxline; ++it, ++round)
+        auto delta = std::find_if(expired_woods.begin(), expired_woods.end(),
+                                  [&](const auto &d) { return d.first == it->producer; });
+        if (delta != expired_woods.end())
         {
-            auto producer = _producers.find(it->producer.value);
-
-            if (producer != _producers.end())
-            {
-                _producers.modify(producer, eosio::same_payer, [&](auto &p) {
-                    p.valid_woods = p.valid_woods - it->stat;
-                });
-            }
-
-            // delete record
-            producer_stat_vector.emplace_back(*it);
+            delta->second += it->stat;
+        }
+        else
+        {
+            expired_woods.emplace_back(it->producer, it->stat);
         }
+
+        // delete record
+        it = idx.erase(it);
     }
 
-    for (auto temp : producer_stat_vector)
+    for (const auto &delta : expired_woods)
     {
-        auto itr = _burnproducerstatinfos.find(temp.rowid);
-        if (itr != _burnproducerstatinfos.end())
-        {
-            _burnproducerstatinfos.erase(itr);
-        }
+        // stat rows are only recorded for registered producers
+        _prodstats.modify(get_producer_stats(delta.first), eosio::same_payer, [&](auto &p) {
+            p.valid_woods = p.valid_woods - delta.second;
+        });
     }
 
     return maxline - round;
@@ -423,21 +722,34 @@ uint32_t system_contract::clean_dirty_stat_producers(uint32_t block_number,
      */
 double system_contract::calc_diff(uint32_t block_number)
 {
-    auto last1 =
-        _burnblockstatinfos.find(block_number - (uint32_t)eosio::internal_use_do_not_use::forest_space_number());
-    auto diff1 = ((last1 == _burnblockstatinfos.end()) ? 1 : last1->diff);
-    auto wood1 =
-        ((last1 == _burnblockstatinfos.end()) ? TARGET_WOOD_NUMBER : last1->stat);
-    auto last2 = _burnblockstatinfos.find(block_number -
-                                          2 * (uint32_t)eosio::internal_use_do_not_use::forest_space_number());
-    auto diff2 = ((last2 == _burnblockstatinfos.end()) ? 1 : last2->diff);
-    auto wood2 =
-        ((last2 == _burnblockstatinfos.end()) ? TARGET_WOOD_NUMBER : last2->stat);
-    auto last3 = _burnblockstatinfos.find(block_number -
-                                          3 * (uint32_t)eosio::internal_use_do_not_use::forest_space_number());
-    auto diff3 = ((last3 == _burnblockstatinfos.end()) ? 1 : last3->diff);
-    auto wood3 =
-        ((last3 == _burnblockstatinfos.end()) ? TARGET_WOOD_NUMBER : last3->stat);
+    const uint32_t forest_space = (uint32_t)eosio::internal_use_do_not_use::forest_space_number();
+    wood_diff_history_singleton diff_history(_self, _self.value);
+    auto history = diff_history.get_or_default();
+
+    // wood count and difficulty of the forest space started n spaces ago
+    auto last = [&](uint32_t n) -> std::pair<uint32_t, double> {
+        if (block_number > n * forest_space)
+        {
+            const uint32_t last_block = block_number - n * forest_space;
+            const auto &slot = history.slot(last_block, forest_space);
+            if (slot.block_number == last_block && slot.diff > 0)
+            {
+                return {slot.stat, slot.diff};
+            }
+
+            // recorded before the difficulty history existed
+            auto legacy = _burnblockstatinfos.find(last_block);
+            if (legacy != _burnblockstatinfos.end())
+            {
+                return {legacy->stat, legacy->diff};
+            }
+        }
+        return {TARGET_WOOD_NUMBER, 1};
+    };
+
+    const auto [wood1, diff1] = last(1);
+    const auto [wood2, diff2] = last(2);
+    const auto [wood3, diff3] = last(3);
 
     // Suppose the last 3 cycle,the diff is diff1,diff2,diff2, and the answers
     // count is wood1,wood2,wood3
@@ -452,70 +764,61 @@ double system_contract::calc_diff(uint32_t block_number)
         targetdiff = 0.1;
     }
 
-    auto current = _burnblockstatinfos.find(block_number);
-    if (current == _burnblockstatinfos.end())
+    auto &current = history.slot(block_number, forest_space);
+    if (current.block_number == block_number && current.diff > 0)
     {
-        // payer is the system account
-        _burnblockstatinfos.emplace(_self, [&](auto &p) {
-            p.block_number = block_number;
-            p.diff = targetdiff;
-            p.stat = 0;
-        });
+        current.diff = targetdiff;
     }
     else
     {
-        _burnblockstatinfos.modify(current, eosio::same_payer,
-                                   [&](auto &p) { p.diff = targetdiff; });
+        current = wood_diff_slot{block_number, 0, targetdiff};
     }
 
+    // payer is the system account
+    diff_history.set(history, _self);
+
     return targetdiff;
 }
 
-void system_contract::clean_diff_stat_history(uint32_t block_number)
+uint32_t system_contract::clean_dirty_wood_history(uint32_t block_number,
+                                                   uint32_t maxline)
 {
-    auto itr = _burnblockstatinfos.begin();
 
-    std::vector<wood_burn_block_stat> stat_vector;
+    if (block_number <= eosio::internal_use_do_not_use::forest_period_number())
+        return maxline;
 
-    while (itr != _burnblockstatinfos.end())
-    {
-        if (itr->block_number + 3 * (uint32_t)eosio::internal_use_do_not_use::forest_space_number() <
-            block_number)
-        {
-            stat_vector.emplace_back(*itr);
-            itr++;
-        }
-        else
-        {
-            break;
-        }
-    }
+    const uint32_t expired_block = block_number - eosio::internal_use_do_not_use::forest_period_number();
+
+    uint32_t remain = expire_wood_history(_burnbininfos, expired_block, maxline);
+    _gstate3.woodbin_rows -= std::min<uint64_t>(_gstate3.woodbin_rows, maxline - remain);
 
-    for (auto temp : stat_vector)
+    if (!_gstate3.woods_migrated)
     {
-        auto temp2 = _burnblockstatinfos.find(temp.block_number);
-        if (temp2 != _burnblockstatinfos.end())
-        {
-            _burnblockstatinfos.erase(temp2);
-        }
+        remain = expire_wood_history(_burninfos, expired_block, remain);
     }
+
+    return remain;
 }
 
-uint32_t system_contract::clean_dirty_wood_history(uint32_t block_number,
-                                                   uint32_t maxline)
+/**
+ * Erases up to `maxline` wood rows burnt for a block lower than `bound`.
+ *
+ * @return the part of `maxline` that was not used
+ */
+template <typename Table>
+uint32_t system_contract::expire_wood_history(Table &table, uint32_t bound, uint32_t maxline)
 {
-
-    auto idx = _burninfos.get_index<"blocknumber"_n>();
+    auto idx = table.template get_index<"blocknumber"_n>();
     auto cust_itr = idx.begin();
     uint32_t round = 0;
 
-    std::vector<wood_burn_info> wood_vector;
+    std::vector<uint64_t> wood_rowids;
     while (cust_itr != idx.end() && round < maxline)
     {
-        if (cust_itr->block_number < block_number - eosio::internal_use_do_not_use::forest_period_number())
+        if (cust_itr->block_number < bound)
         {
             // delete record
-            wood_vector.emplace_back(*cust_itr);
+            wood_rowids.emplace_back(cust_itr->rowid);
             cust_itr++;
             round++;
         }
@@ -525,12 +828,12 @@ uint32_t system_contract::clean_dirty_wood_history(uint32_t block_number,
         }
     }
 
-    for (auto temp : wood_vector)
+    for (auto rowid : wood_rowids)
     {
-        auto itr = _burninfos.find(temp.rowid);
-        if (itr != _burninfos.end())
+        auto itr = table.find(rowid);
+        if (itr != table.end())
         {
-            _burninfos.erase(itr);
+            table.erase(itr);
         }
     }
 
@@ -19,9 +19,18 @@ namespace celesos
       [[eosio::action]]
       void blockrandom(const uint32_t block_number);
 
+      /**
+       * Runs `iterations` Bancor issue/redeem pairs at rammarket sizes, with the fixed-point kernel of
+       * celesos.system/bancor.hpp or, if `legacy` is set, with the doubles it replaced. The CPU billed
+       * for the action, less that of `iterations` 0, is the cost of the conversions in WASM.
+       */
+      [[eosio::action]]
+      void benchbancor(const uint32_t iterations, const bool legacy);
+
       using helloworld_action = eosio::action_wrapper<"helloworld"_n, &test::helloworld>;
       using sayhello_action = eosio::action_wrapper<"sayhello"_n, &test::sayhello>;
       using blockrandom_action = eosio::action_wrapper<"blockrandom"_n, &test::blockrandom>;
+      using benchbancor_action = eosio::action_wrapper<"benchbancor"_n, &test::benchbancor>;
   };
 
 } // namespace celesos
\ No newline at end of file
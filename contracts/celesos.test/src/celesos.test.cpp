@@ -1,6 +1,9 @@
 #include <celesos.test/celesos.test.hpp>
+#include <celesos.system/bancor.hpp>
 #include <eosio/privileged.hpp>
 
+#include <cmath>
+
 namespace celesos {
 
    void test::helloworld(eosio::name from) {
@@ -15,4 +18,23 @@ namespace celesos {
       uint64_t block_random = eosio::block_random_by_num(block_number);
       eosio::print("block_random_by_num:",block_random);
    }
+
+   void test::benchbancor(const uint32_t iterations, const bool legacy) {
+      const int64_t supply  = 100000000000000ll;
+      const int64_t reserve = 64ll * 1024 * 1024 * 1024;
+      const uint64_t weight = celesossystem::bancor::to_weight(.5);
+
+      uint64_t folded = 0;
+      for (uint32_t i = 0; i < iterations; ++i) {
+         const int64_t amount = int64_t((i * 0x9E3779B97F4A7C15ull) % 10000000000ull + 1);
+         if (legacy) {
+            folded += uint64_t(supply * (std::pow(1. + double(amount) / reserve, .5) - 1.));
+            folded += uint64_t(reserve * (1. - std::pow(1. - double(amount) / supply, 2.)));
+         } else {
+            folded += uint64_t(celesossystem::bancor::issue(supply, reserve, amount, weight));
+            folded += uint64_t(celesossystem::bancor::redeem(supply, reserve, amount, weight));
+         }
+      }
+      eosio::print("benchbancor:", folded);
+   }
 } /// namespace celesos
\ No newline at end of file
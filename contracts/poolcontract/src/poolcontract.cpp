@@ -1,4 +1,5 @@
 #include <poolcontract/poolcontract.hpp>
+#include <celesos.system/reward_schedule.hpp>
 #include <celes.token/celes.token.hpp>
 
 #define ALL_REWARD 10000000
@@ -29,8 +30,8 @@ namespace celesos {
          uint128_t all_new_coefficient = (current_block_number - _stake_gstate.last_settlement) * _stake_gstate.all_stake.amount;
          _stake_gstate.all_coefficient += all_new_coefficient;
          eosio::asset unreceived_reward = _stake_gstate.all_reward - _stake_gstate.all_unreceived_reward;
-         int half_life_period = (int)(log(ALL_REWARD/unreceived_reward.amount)/log(2));
-         uint64_t increased_reward = (uint64_t)((ALL_REWARD/2/HALF_LIFT_PERIOD)*(current_block_number - _stake_gstate.last_settlement)*pow(0.5,half_life_period));
+         uint32_t half_life_period = celesossystem::halving_tier(ALL_REWARD, unreceived_reward.amount);
+         uint64_t increased_reward = (uint64_t)((ALL_REWARD/2/HALF_LIFT_PERIOD)*(current_block_number - _stake_gstate.last_settlement)) >> half_life_period;
          _stake_gstate.all_unreceived_reward += eosio::asset(increased_reward, core_symbol);
       }
       
@@ -0,0 +1,164 @@
+#include <host_test.hpp>
+
+#include <celesos.system/bancor.hpp>
+
+#include <cmath>
+#include <random>
+
+using namespace celesossystem;
+using namespace celesostest;
+
+/// `convert_to_exchange` as the system contract computed it before bancor.hpp
+static int64_t legacy_issue( int64_t supply, int64_t reserve, int64_t payment, double weight ) {
+   const double S0 = supply;
+   const double R0 = reserve;
+   const double dR = payment;
+   double dS = S0 * ( std::pow(1. + dR / R0, weight) - 1. );
+   if ( dS < 0 ) dS = 0;
+   return int64_t(dS);
+}
+
+/// `convert_from_exchange` as the system contract computed it before bancor.hpp
+static int64_t legacy_redeem( int64_t supply, int64_t reserve, int64_t tokens, double weight ) {
+   const double R0 = reserve;
+   const double S0 = supply;
+   const double dS = -tokens;
+   double dR = R0 * ( std::pow(1. + dS / S0, 1. / weight) - 1. );
+   if ( dR > 0 ) dR = 0;
+   return int64_t(-dR);
+}
+
+/// `exchange_state::get_bancor_output` as the system contract computed it before bancor.hpp
+static int64_t legacy_output( int64_t inp_reserve, int64_t out_reserve, int64_t inp ) {
+   const double ib = inp_reserve;
+   const double ob = out_reserve;
+   const double in = inp;
+   int64_t out = int64_t( (in * ob) / (ib + in) );
+   if ( out < 0 ) out = 0;
+   return out;
+}
+
+/// `exchange_state::get_bancor_input` as the system contract computed it before bancor.hpp
+static int64_t legacy_input( int64_t out_reserve, int64_t inp_reserve, int64_t out ) {
+   const double ob = out_reserve;
+   const double ib = inp_reserve;
+   int64_t inp = (ib * out) / (ob - out);
+   if ( inp < 0 ) inp = 0;
+   return inp;
+}
+
+/// unrounded conversions in extended precision, the reference both implementations are measured against
+static long double exact_issue( int64_t supply, int64_t reserve, int64_t payment, long double weight ) {
+   return supply * expm1l( weight * log1pl( (long double)payment / reserve ) );
+}
+
+static long double exact_redeem( int64_t supply, int64_t reserve, int64_t tokens, long double weight ) {
+   return -reserve * expm1l( log1pl( -(long double)tokens / supply ) / weight );
+}
+
+struct error_stats {
+   long double max_error = 0;
+   uint64_t    above_one = 0;
+
+   void add( int64_t result, long double exact ) {
+      const long double error = fabsl( (long double)result - exact );
+      max_error = std::max( max_error, error );
+      if( error > 1 )
+         ++above_one;
+   }
+};
+
+int main() {
+   std::mt19937_64 rng( 20190501 );
+
+   // ranges seen by the rammarket: RAMCORE supply, up to 64 GiB of RAM and 10^9 tokens in the quote
+   // connector, conversions of a single token unit up to a fifth of a reserve
+   std::uniform_int_distribution<int64_t> supplies( 1000000000000ll, 100000000000000ll );
+   std::uniform_int_distribution<int64_t> reserves( 1000000ll, 10000000000000ll );
+   std::uniform_real_distribution<double> fractions( -12., std::log10( .2 ) );
+   const double weights[] = { .5, .25, .75 };
+
+   error_stats fixed_issue_error, legacy_issue_error, fixed_redeem_error, legacy_redeem_error;
+   const uint64_t samples = 1000000;
+   for( uint64_t i = 0; i < samples; ++i ) {
+      const double   weight  = weights[i % 3];
+      const uint64_t fixed_weight = bancor::to_weight( weight );
+      const int64_t  supply  = supplies( rng );
+      const int64_t  reserve = reserves( rng );
+
+      const int64_t payment = std::max( int64_t(1), int64_t( reserve * std::pow( 10., fractions( rng ) ) ) );
+      const long double issued = exact_issue( supply, reserve, payment, weight );
+      fixed_issue_error.add( bancor::issue( supply, reserve, payment, fixed_weight ), issued );
+      legacy_issue_error.add( legacy_issue( supply, reserve, payment, weight ), issued );
+
+      const int64_t tokens = std::max( int64_t(1), int64_t( supply * std::pow( 10., fractions( rng ) ) ) );
+      const long double redeemed = exact_redeem( supply, reserve, tokens, weight );
+      fixed_redeem_error.add( bancor::redeem( supply, reserve, tokens, fixed_weight ), redeemed );
+      legacy_redeem_error.add( legacy_redeem( supply, reserve, tokens, weight ), redeemed );
+   }
+
+   // the constant product conversions are exact, each result is the floor of its quotient
+   uint64_t output_mismatches = 0, input_mismatches = 0;
+   int64_t  legacy_output_error = 0, legacy_input_error = 0;
+   for( uint64_t i = 0; i < samples; ++i ) {
+      const int64_t inp_reserve = reserves( rng );
+      const int64_t out_reserve = reserves( rng );
+
+      const int64_t inp = std::max( int64_t(1), int64_t( inp_reserve * std::pow( 10., fractions( rng ) ) ) );
+      const int64_t out = bancor::output( inp_reserve, out_reserve, inp );
+      const __int128 paid = __int128(inp) * out_reserve;
+      if( __int128(out) * (inp_reserve + inp) > paid || __int128(out + 1) * (inp_reserve + inp) <= paid )
+         ++output_mismatches;
+      legacy_output_error = std::max( legacy_output_error, std::abs( legacy_output( inp_reserve, out_reserve, inp ) - out ) );
+
+      const int64_t wanted = std::max( int64_t(1), int64_t( out_reserve * std::pow( 10., fractions( rng ) ) ) );
+      const int64_t cost = bancor::input( out_reserve, inp_reserve, wanted );
+      const __int128 owed = __int128(inp_reserve) * wanted;
+      if( __int128(cost) * (out_reserve - wanted) > owed || __int128(cost + 1) * (out_reserve - wanted) <= owed )
+         ++input_mismatches;
+      legacy_input_error = std::max( legacy_input_error, std::abs( legacy_input( out_reserve, inp_reserve, wanted ) - cost ) );
+   }
+   HOST_CHECK( output_mismatches == 0 );
+   HOST_CHECK( input_mismatches == 0 );
+   HOST_CHECK( bancor::output( 1000, 1000, -2000 ) == 0 );
+   HOST_CHECK( bancor::input( 1000, 1000, 1000 ) == 0 );
+
+   std::printf( "max error in token units over %llu conversions\n", (unsigned long long)samples );
+   std::printf( "%-40s %10.3Lf (%llu above 1)\n", "bancor::issue", fixed_issue_error.max_error, (unsigned long long)fixed_issue_error.above_one );
+   std::printf( "%-40s %10.3Lf (%llu above 1)\n", "legacy issue", legacy_issue_error.max_error, (unsigned long long)legacy_issue_error.above_one );
+   std::printf( "%-40s %10.3Lf (%llu above 1)\n", "bancor::redeem", fixed_redeem_error.max_error, (unsigned long long)fixed_redeem_error.above_one );
+   std::printf( "%-40s %10.3Lf (%llu above 1)\n", "legacy redeem", legacy_redeem_error.max_error, (unsigned long long)legacy_redeem_error.above_one );
+   std::printf( "%-40s %10lld\n", "legacy output off bancor::output by", (long long)legacy_output_error );
+   std::printf( "%-40s %10lld\n", "legacy input off bancor::input by", (long long)legacy_input_error );
+
+   // the kernel rounds down, so it is off by the truncation plus its own error of a fraction of a unit
+   HOST_CHECK( fixed_issue_error.max_error < 1.1L );
+   HOST_CHECK( fixed_redeem_error.max_error < 1.1L );
+
+   const int64_t  supply  = 100000000000000ll;
+   const int64_t  reserve = 64ll * 1024 * 1024 * 1024;
+   const uint64_t calls   = 1000000;
+   auto amount = []( uint64_t i ) { return int64_t( (i * 0x9E3779B97F4A7C15ull) % 10000000000ull + 1 ); };
+
+   report( "bancor::issue", ns_per_call( calls, [&]( uint64_t i ) {
+      return bancor::issue( supply, reserve, amount( i ), bancor::to_weight( .5 ) );
+   }));
+   report( "legacy issue", ns_per_call( calls, [&]( uint64_t i ) {
+      return legacy_issue( supply, reserve, amount( i ), .5 );
+   }));
+   report( "bancor::redeem", ns_per_call( calls, [&]( uint64_t i ) {
+      return bancor::redeem( supply, reserve, amount( i ), bancor::to_weight( .5 ) );
+   }));
+   report( "legacy redeem", ns_per_call( calls, [&]( uint64_t i ) {
+      return legacy_redeem( supply, reserve, amount( i ), .5 );
+   }));
+   report( "bancor::output", ns_per_call( calls, [&]( uint64_t i ) {
+      return bancor::output( reserve, supply, amount( i ) );
+   }));
+   report( "legacy output", ns_per_call( calls, [&]( uint64_t i ) {
+      return legacy_output( reserve, supply, amount( i ) );
+   }));
+   std::printf( "the host has hardware floating point, in WASM the legacy doubles run in software\n" );
+
+   return result();
+}
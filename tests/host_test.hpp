@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace celesostest {
+
+   inline int failures = 0;
+
+   /// keeps benchmarked results alive without the compiler seeing through them
+   inline volatile uint64_t sink = 0;
+
+   inline void check( bool condition, const char* expression, const char* file, int line ) {
+      if( !condition ) {
+         std::fprintf( stderr, "%s:%d: check failed: %s\n", file, line, expression );
+         ++failures;
+      }
+   }
+
+   /**
+    * Average wall time of `f( i )` over `calls` calls, in nanoseconds.
+    *
+    * @details `f` returns a value folded into `sink`, so the calls are not optimized away.
+    */
+   template<typename F>
+   double ns_per_call( uint64_t calls, F&& f ) {
+      const auto start = std::chrono::steady_clock::now();
+      uint64_t folded = 0;
+      for( uint64_t i = 0; i < calls; ++i )
+         folded += uint64_t( f( i ) );
+      const auto stop = std::chrono::steady_clock::now();
+      sink = sink + folded;
+      return std::chrono::duration<double, std::nano>( stop - start ).count() / double(calls);
+   }
+
+   inline void report( const char* name, double ns ) {
+      std::printf( "%-40s %10.1f ns/call\n", name, ns );
+   }
+
+   /// exit status of a test, reports the number of failed checks
+   inline int result() {
+      if( failures != 0 )
+         std::fprintf( stderr, "%d check(s) failed\n", failures );
+      return failures == 0 ? 0 : 1;
+   }
+
+} /// namespace celesostest
+
+#define HOST_CHECK( condition ) ::celesostest::check( (condition), #condition, __FILE__, __LINE__ )
@@ -0,0 +1,43 @@
+#include <host_test.hpp>
+
+#include <celesos.system/bancor.hpp>
+#include <celesos.system/reward_schedule.hpp>
+
+using namespace celesossystem;
+using namespace celesostest;
+
+// copied from celesos.system.hpp, which needs the eosio headers
+static constexpr uint64_t pay_pool_full = uint64_t(21 * 10000 * 10000) * 1500;
+static constexpr int64_t  origin_reward = 5000;
+
+using pay_schedule = reward_schedule<pay_pool_full, origin_reward>;
+
+/// spreads `i` over [1, n] so consecutive calls do not hit the same tier or ratio
+static uint64_t spread( uint64_t i, uint64_t n ) {
+   return (i * 0x9E3779B97F4A7C15ull) % n + 1;
+}
+
+int main() {
+   const uint64_t calls = 1000000;
+
+   HOST_CHECK( pay_schedule::amount( int64_t(pay_pool_full) ) == origin_reward );
+   HOST_CHECK( pay_schedule::amount( 1 ) == 1 );
+   HOST_CHECK( bancor::issue( 1000000, 1000000, 3000000, bancor::to_weight( .5 ) ) == 1000000 );
+   HOST_CHECK( bancor::redeem( 1000000, 1000000, 500000, bancor::to_weight( .5 ) ) == 750000 );
+
+   report( "reward_schedule::amount", ns_per_call( calls, []( uint64_t i ) {
+      return pay_schedule::amount( int64_t(spread( i, pay_pool_full )) );
+   }));
+
+   const int64_t  supply = 100000000000000ll;
+   const int64_t  reserve = 64ll * 1024 * 1024 * 1024;
+   const uint64_t weight = bancor::to_weight( .5 );
+   report( "bancor::issue", ns_per_call( calls, [&]( uint64_t i ) {
+      return bancor::issue( supply, reserve, int64_t(spread( i, 100000000000ull )), weight );
+   }));
+   report( "bancor::redeem", ns_per_call( calls, [&]( uint64_t i ) {
+      return bancor::redeem( supply, reserve, int64_t(spread( i, 100000000000ull )), weight );
+   }));
+
+   return result();
+}
@@ -0,0 +1,604 @@
+#include "chain.hpp"
+
+#include <celes.token/celes.token.hpp>
+
+#include <eosio/multi_index.hpp>
+#include <eosio/privileged.hpp>
+#include <eosio/producer_schedule.hpp>
+#include <eosio/tester.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+using namespace eosio::native;
+
+namespace celesostest {
+
+   namespace {
+
+      constexpr eosio::name token_account{"celes.token"_n};
+
+      /// 2018-06-01T12:00:00, the block timestamp epoch used for block 0
+      constexpr uint64_t genesis_us = 1527854400ull * 1000000;
+
+      // mirrors of the token contract's private tables
+      struct token_balance {
+         eosio::asset balance;
+
+         uint64_t primary_key()const { return balance.symbol.code().raw(); }
+
+         EOSLIB_SERIALIZE( token_balance, (balance) )
+      };
+
+      struct token_stats {
+         eosio::asset supply;
+         eosio::asset max_supply;
+         eosio::name  issuer;
+
+         uint64_t primary_key()const { return supply.symbol.code().raw(); }
+
+         EOSLIB_SERIALIZE( token_stats, (supply)(max_supply)(issuer) )
+      };
+
+      typedef eosio::multi_index< "accounts"_n, token_balance > token_accounts;
+      typedef eosio::multi_index< "stat"_n, token_stats > token_stats_table;
+
+      void fail( const char* msg, size_t len ) {
+         std::fprintf( stderr, "assertion failure: %.*s\n", int(len), msg );
+         std::exit( EXIT_FAILURE );
+      }
+
+   } /// namespace
+
+   usage& usage::operator+=( const usage& u ) {
+      rows_read      += u.rows_read;
+      rows_written   += u.rows_written;
+      index_ops      += u.index_ops;
+      bytes_read     += u.bytes_read;
+      bytes_written  += u.bytes_written;
+      inline_actions += u.inline_actions;
+      return *this;
+   }
+
+   chain& chain::get() {
+      static chain c;
+      return c;
+   }
+
+   chain::chain()
+   :idx64(*this), idx128(*this), idx256(*this), idx_double(*this) {}
+
+   void chain::set_head( uint32_t block_number ) {
+      head_block = block_number;
+   }
+
+   void chain::begin_action( eosio::name r ) {
+      current = usage{};
+      inline_queue.clear();
+      switch_receiver( r );
+   }
+
+   void chain::switch_receiver( eosio::name r ) {
+      // iterators do not outlive the action that made them
+      receiver = r;
+      iterators.clear();
+      idx64.clear_iterators();
+      idx128.clear_iterators();
+      idx256.clear_iterators();
+      idx_double.clear_iterators();
+   }
+
+   void chain::run_inline_actions() {
+      // the queue grows while it is run if an inline action sends another one
+      for( size_t i = 0; i < inline_queue.size(); ++i ) {
+         const auto act = eosio::unpack<eosio::action>( inline_queue[i] );
+         ++current.inline_actions;
+         if( act.account != token_account )
+            continue;
+
+         switch_receiver( token_account );
+         apply_token_action( act );
+      }
+   }
+
+   void chain::apply_token_action( const eosio::action& act ) {
+      if( act.name == "transfer"_n ) {
+         const auto [from, to, quantity, memo] =
+            eosio::unpack<std::tuple<eosio::name, eosio::name, eosio::asset, std::string>>( act.data );
+         transfer( from, to, quantity );
+         current.inline_actions += 2; // from and to are notified
+      } else if( act.name == "transfermany"_n ) {
+         const auto [from, sym, transfers, notify] =
+            eosio::unpack<std::tuple<eosio::name, eosio::symbol, std::vector<celes::token::transfer_entry>, bool>>( act.data );
+         for( const auto& t : transfers )
+            transfer( from, t.to, eosio::asset( t.amount, sym ) );
+         current.inline_actions += 1 + (notify ? transfers.size() : 0);
+      } else if( act.name == "open"_n ) {
+         const auto [owner, sym, ram_payer] =
+            eosio::unpack<std::tuple<eosio::name, eosio::symbol, eosio::name>>( act.data );
+         if( balance( owner, sym ).amount == 0 )
+            issue( owner, eosio::asset( 0, sym ) );
+      }
+   }
+
+   void chain::transfer( eosio::name from, eosio::name to, const eosio::asset& quantity ) {
+      token_accounts from_acnts( token_account, from.value );
+      const auto& f = from_acnts.get( quantity.symbol.code().raw(), "no balance object found" );
+      eosio::check( f.balance.amount >= quantity.amount, "overdrawn balance" );
+      from_acnts.modify( f, eosio::same_payer, [&]( auto& a ) {
+         a.balance -= quantity;
+      });
+      issue( to, quantity );
+   }
+
+   void chain::create_token( const eosio::asset& supply ) {
+      apply( token_account, [&] {
+         token_stats_table stats( token_account, supply.symbol.code().raw() );
+         stats.emplace( token_account, [&]( auto& s ) {
+            s.supply     = supply;
+            s.max_supply = supply;
+            s.issuer     = token_account;
+         });
+      });
+   }
+
+   void chain::issue( eosio::name owner, const eosio::asset& quantity ) {
+      const eosio::name outer = receiver;
+      receiver = token_account;
+      token_accounts acnts( token_account, owner.value );
+      auto it = acnts.find( quantity.symbol.code().raw() );
+      if( it == acnts.end() ) {
+         acnts.emplace( token_account, [&]( auto& a ) {
+            a.balance = quantity;
+         });
+      } else {
+         acnts.modify( it, eosio::same_payer, [&]( auto& a ) {
+            a.balance += quantity;
+         });
+      }
+      receiver = outer;
+   }
+
+   eosio::asset chain::balance( eosio::name owner, const eosio::symbol& sym ) {
+      token_accounts acnts( token_account, owner.value );
+      auto it = acnts.find( sym.code().raw() );
+      return it == acnts.end() ? eosio::asset( 0, sym ) : it->balance;
+   }
+
+   chain::table& chain::find_table( uint64_t code, uint64_t scope, uint64_t table_name ) {
+      return tables[table_id{code, scope, table_name}];
+   }
+
+   int32_t chain::db_store( uint64_t scope, uint64_t table_name, uint64_t id, const void* data, uint32_t len ) {
+      auto& t = find_table( receiver.value, scope, table_name );
+      eosio::check( t.find( id ) == t.end(), "db_store_i64: primary key already exists" );
+      const char* bytes = static_cast<const char*>( data );
+      t.emplace( id, std::vector<char>( bytes, bytes + len ) );
+      ++current.rows_written;
+      current.bytes_written += len;
+      return iterators.row( &t, id );
+   }
+
+   void chain::db_update( int32_t itr, const void* data, uint32_t len ) {
+      eosio::check( itr >= 0, "db_update_i64: invalid iterator" );
+      auto& [t, id] = iterators.rows[itr];
+      const char* bytes = static_cast<const char*>( data );
+      t->at( id ).assign( bytes, bytes + len );
+      ++current.rows_written;
+      current.bytes_written += len;
+   }
+
+   void chain::db_remove( int32_t itr ) {
+      eosio::check( itr >= 0, "db_remove_i64: invalid iterator" );
+      auto& [t, id] = iterators.rows[itr];
+      t->erase( id );
+      ++current.rows_written;
+   }
+
+   int32_t chain::db_get( int32_t itr, void* data, uint32_t len ) {
+      eosio::check( itr >= 0, "db_get_i64: invalid iterator" );
+      auto& [t, id] = iterators.rows[itr];
+      const auto& row = t->at( id );
+      if( len > 0 ) {
+         const uint32_t copied = std::min<uint32_t>( len, row.size() );
+         std::memcpy( data, row.data(), copied );
+         ++current.rows_read;
+         current.bytes_read += copied;
+      }
+      return int32_t(row.size());
+   }
+
+   int32_t chain::db_next( int32_t itr, uint64_t* primary ) {
+      if( itr < 0 )
+         return -1;
+      auto [t, id] = iterators.rows[itr];
+      auto it = t->upper_bound( id );
+      if( it == t->end() )
+         return iterators.end( t );
+      *primary = it->first;
+      return iterators.row( t, it->first );
+   }
+
+   int32_t chain::db_previous( int32_t itr, uint64_t* primary ) {
+      table* t = nullptr;
+      table::iterator it;
+      if( itr < 0 ) {
+         t = iterators.end_table( itr );
+         if( t == nullptr || t->empty() )
+            return -1;
+         it = t->end();
+      } else {
+         t = iterators.rows[itr].first;
+         it = t->lower_bound( iterators.rows[itr].second );
+         if( it == t->begin() )
+            return -1;
+      }
+      --it;
+      *primary = it->first;
+      return iterators.row( t, it->first );
+   }
+
+   int32_t chain::db_find( uint64_t code, uint64_t scope, uint64_t table_name, uint64_t id ) {
+      auto& t = find_table( code, scope, table_name );
+      return t.count( id ) ? iterators.row( &t, id ) : iterators.end( &t );
+   }
+
+   int32_t chain::db_lowerbound( uint64_t code, uint64_t scope, uint64_t table_name, uint64_t id ) {
+      auto& t = find_table( code, scope, table_name );
+      auto it = t.lower_bound( id );
+      return it == t.end() ? iterators.end( &t ) : iterators.row( &t, it->first );
+   }
+
+   int32_t chain::db_upperbound( uint64_t code, uint64_t scope, uint64_t table_name, uint64_t id ) {
+      auto& t = find_table( code, scope, table_name );
+      auto it = t.upper_bound( id );
+      return it == t.end() ? iterators.end( &t ) : iterators.row( &t, it->first );
+   }
+
+   int32_t chain::db_end( uint64_t code, uint64_t scope, uint64_t table_name ) {
+      return iterators.end( &find_table( code, scope, table_name ) );
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::at( sec_table& t, typename std::set<std::pair<Key, uint64_t>>::iterator it,
+                                            Key* secondary, uint64_t* primary ) {
+      if( it == t.ordered.end() )
+         return _iterators.end( &t );
+      if( secondary != nullptr )
+         *secondary = it->first;
+      if( primary != nullptr )
+         *primary = it->second;
+      return _iterators.row( &t, it->second );
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::store( uint64_t scope, uint64_t table, uint64_t id, const Key& secondary ) {
+      auto& t = _tables[table_id{_chain.receiver.value, scope, table}];
+      t.by_primary[id] = secondary;
+      t.ordered.emplace( secondary, id );
+      ++_chain.current.index_ops;
+      return _iterators.row( &t, id );
+   }
+
+   template<typename Key>
+   void chain::secondary_index<Key>::update( int32_t itr, const Key& secondary ) {
+      eosio::check( itr >= 0, "db_idx_update: invalid iterator" );
+      auto [t, id] = _iterators.rows[itr];
+      auto& key = t->by_primary.at( id );
+      t->ordered.erase( {key, id} );
+      key = secondary;
+      t->ordered.emplace( secondary, id );
+      ++_chain.current.index_ops;
+   }
+
+   template<typename Key>
+   void chain::secondary_index<Key>::remove( int32_t itr ) {
+      eosio::check( itr >= 0, "db_idx_remove: invalid iterator" );
+      auto [t, id] = _iterators.rows[itr];
+      auto it = t->by_primary.find( id );
+      t->ordered.erase( {it->second, id} );
+      t->by_primary.erase( it );
+      ++_chain.current.index_ops;
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::next( int32_t itr, uint64_t* primary ) {
+      ++_chain.current.index_ops;
+      if( itr < 0 )
+         return -1;
+      auto [t, id] = _iterators.rows[itr];
+      auto it = t->ordered.upper_bound( {t->by_primary.at( id ), id} );
+      return at( *t, it, nullptr, primary );
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::previous( int32_t itr, uint64_t* primary ) {
+      ++_chain.current.index_ops;
+      sec_table* t = nullptr;
+      typename std::set<std::pair<Key, uint64_t>>::iterator it;
+      if( itr < 0 ) {
+         t = _iterators.end_table( itr );
+         if( t == nullptr || t->ordered.empty() )
+            return -1;
+         it = t->ordered.end();
+      } else {
+         t = _iterators.rows[itr].first;
+         const uint64_t id = _iterators.rows[itr].second;
+         it = t->ordered.find( {t->by_primary.at( id ), id} );
+         if( it == t->ordered.begin() )
+            return -1;
+      }
+      --it;
+      return at( *t, it, nullptr, primary );
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::find_primary( uint64_t code, uint64_t scope, uint64_t table, Key& secondary, uint64_t primary ) {
+      ++_chain.current.index_ops;
+      auto& t = _tables[table_id{code, scope, table}];
+      auto it = t.by_primary.find( primary );
+      if( it == t.by_primary.end() )
+         return _iterators.end( &t );
+      secondary = it->second;
+      return _iterators.row( &t, primary );
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::find_secondary( uint64_t code, uint64_t scope, uint64_t table, const Key& secondary, uint64_t* primary ) {
+      ++_chain.current.index_ops;
+      auto& t = _tables[table_id{code, scope, table}];
+      auto it = t.ordered.lower_bound( {secondary, 0} );
+      if( it != t.ordered.end() && it->first != secondary )
+         it = t.ordered.end();
+      return at( t, it, nullptr, primary );
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::lowerbound( uint64_t code, uint64_t scope, uint64_t table, Key& secondary, uint64_t* primary ) {
+      ++_chain.current.index_ops;
+      auto& t = _tables[table_id{code, scope, table}];
+      return at( t, t.ordered.lower_bound( {secondary, 0} ), &secondary, primary );
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::upperbound( uint64_t code, uint64_t scope, uint64_t table, Key& secondary, uint64_t* primary ) {
+      ++_chain.current.index_ops;
+      auto& t = _tables[table_id{code, scope, table}];
+      const auto bound = std::make_pair( secondary, std::numeric_limits<uint64_t>::max() );
+      return at( t, t.ordered.upper_bound( bound ), &secondary, primary );
+   }
+
+   template<typename Key>
+   int32_t chain::secondary_index<Key>::end( uint64_t code, uint64_t scope, uint64_t table ) {
+      return _iterators.end( &_tables[table_id{code, scope, table}] );
+   }
+
+   namespace {
+
+      using key256 = std::array<uint128_t, 2>;
+
+      key256 to_key256( const uint128_t* data ) {
+         return key256{ data[0], data[1] };
+      }
+
+   } /// namespace
+
+   /// installs the `db_idx*` intrinsics of one secondary key type, `Key*` is how the chain passes keys
+   #define CELESOS_SECONDARY_INTRINSICS( IDX, INDEX )                                                                \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_store>( [&]( uint64_t scope, uint64_t table, uint64_t,     \
+                                                                    uint64_t id, const auto* secondary ) {        \
+         return INDEX.store( scope, table, id, *secondary );                                                      \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_update>( [&]( int32_t itr, uint64_t, const auto* secondary ) { \
+         INDEX.update( itr, *secondary );                                                                         \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_remove>( [&]( int32_t itr ) {                              \
+         INDEX.remove( itr );                                                                                     \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_next>( [&]( int32_t itr, uint64_t* primary ) {             \
+         return INDEX.next( itr, primary );                                                                       \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_previous>( [&]( int32_t itr, uint64_t* primary ) {         \
+         return INDEX.previous( itr, primary );                                                                   \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_find_primary>( [&]( uint64_t code, uint64_t scope,         \
+                                                                           uint64_t table, auto* secondary,       \
+                                                                           uint64_t primary ) {                   \
+         return INDEX.find_primary( code, scope, table, *secondary, primary );                                    \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_find_secondary>( [&]( uint64_t code, uint64_t scope,       \
+                                                                             uint64_t table, const auto* secondary, \
+                                                                             uint64_t* primary ) {                \
+         return INDEX.find_secondary( code, scope, table, *secondary, primary );                                  \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_lowerbound>( [&]( uint64_t code, uint64_t scope,           \
+                                                                         uint64_t table, auto* secondary,         \
+                                                                         uint64_t* primary ) {                    \
+         return INDEX.lowerbound( code, scope, table, *secondary, primary );                                      \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_upperbound>( [&]( uint64_t code, uint64_t scope,           \
+                                                                         uint64_t table, auto* secondary,         \
+                                                                         uint64_t* primary ) {                    \
+         return INDEX.upperbound( code, scope, table, *secondary, primary );                                      \
+      });                                                                                                         \
+      intrinsics::set_intrinsic<intrinsics::db_##IDX##_end>( [&]( uint64_t code, uint64_t scope, uint64_t table ) { \
+         return INDEX.end( code, scope, table );                                                                  \
+      });
+
+   void chain::install() {
+      // tables
+      intrinsics::set_intrinsic<intrinsics::db_store_i64>( [&]( uint64_t scope, uint64_t table, uint64_t,
+                                                                uint64_t id, const void* data, uint32_t len ) {
+         return db_store( scope, table, id, data, len );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_update_i64>( [&]( int32_t itr, uint64_t, const void* data, uint32_t len ) {
+         db_update( itr, data, len );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_remove_i64>( [&]( int32_t itr ) {
+         db_remove( itr );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_get_i64>( [&]( int32_t itr, const void* data, uint32_t len ) {
+         return db_get( itr, const_cast<void*>( data ), len );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_next_i64>( [&]( int32_t itr, uint64_t* primary ) {
+         return db_next( itr, primary );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_previous_i64>( [&]( int32_t itr, uint64_t* primary ) {
+         return db_previous( itr, primary );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_find_i64>( [&]( uint64_t code, uint64_t scope, uint64_t table, uint64_t id ) {
+         return db_find( code, scope, table, id );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_lowerbound_i64>( [&]( uint64_t code, uint64_t scope, uint64_t table, uint64_t id ) {
+         return db_lowerbound( code, scope, table, id );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_upperbound_i64>( [&]( uint64_t code, uint64_t scope, uint64_t table, uint64_t id ) {
+         return db_upperbound( code, scope, table, id );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_end_i64>( [&]( uint64_t code, uint64_t scope, uint64_t table ) {
+         return db_end( code, scope, table );
+      });
+
+      CELESOS_SECONDARY_INTRINSICS( idx64, idx64 )
+      CELESOS_SECONDARY_INTRINSICS( idx128, idx128 )
+      CELESOS_SECONDARY_INTRINSICS( idx_double, idx_double )
+
+      // 256 bit keys are passed as two 128 bit words and a word count
+      intrinsics::set_intrinsic<intrinsics::db_idx256_store>( [&]( uint64_t scope, uint64_t table, uint64_t, uint64_t id,
+                                                                   const uint128_t* data, uint32_t ) {
+         return idx256.store( scope, table, id, to_key256( data ) );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_update>( [&]( int32_t itr, uint64_t, const uint128_t* data, uint32_t ) {
+         idx256.update( itr, to_key256( data ) );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_remove>( [&]( int32_t itr ) {
+         idx256.remove( itr );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_next>( [&]( int32_t itr, uint64_t* primary ) {
+         return idx256.next( itr, primary );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_previous>( [&]( int32_t itr, uint64_t* primary ) {
+         return idx256.previous( itr, primary );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_find_primary>( [&]( uint64_t code, uint64_t scope, uint64_t table,
+                                                                          uint128_t* data, uint32_t, uint64_t primary ) {
+         key256 key;
+         const int32_t itr = idx256.find_primary( code, scope, table, key, primary );
+         if( itr >= 0 )
+            std::copy( key.begin(), key.end(), data );
+         return itr;
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_find_secondary>( [&]( uint64_t code, uint64_t scope, uint64_t table,
+                                                                            const uint128_t* data, uint32_t, uint64_t* primary ) {
+         return idx256.find_secondary( code, scope, table, to_key256( data ), primary );
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_lowerbound>( [&]( uint64_t code, uint64_t scope, uint64_t table,
+                                                                        uint128_t* data, uint32_t, uint64_t* primary ) {
+         key256 key = to_key256( data );
+         const int32_t itr = idx256.lowerbound( code, scope, table, key, primary );
+         std::copy( key.begin(), key.end(), data );
+         return itr;
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_upperbound>( [&]( uint64_t code, uint64_t scope, uint64_t table,
+                                                                        uint128_t* data, uint32_t, uint64_t* primary ) {
+         key256 key = to_key256( data );
+         const int32_t itr = idx256.upperbound( code, scope, table, key, primary );
+         std::copy( key.begin(), key.end(), data );
+         return itr;
+      });
+      intrinsics::set_intrinsic<intrinsics::db_idx256_end>( [&]( uint64_t code, uint64_t scope, uint64_t table ) {
+         return idx256.end( code, scope, table );
+      });
+
+      // actions and authorization
+      intrinsics::set_intrinsic<intrinsics::current_receiver>( [&]() {
+         return receiver.value;
+      });
+      intrinsics::set_intrinsic<intrinsics::require_auth>( []( uint64_t ) {} );
+      intrinsics::set_intrinsic<intrinsics::require_auth2>( []( uint64_t, uint64_t ) {} );
+      intrinsics::set_intrinsic<intrinsics::has_auth>( []( uint64_t ) { return true; } );
+      intrinsics::set_intrinsic<intrinsics::is_account>( []( uint64_t ) { return true; } );
+      intrinsics::set_intrinsic<intrinsics::require_recipient>( [&]( uint64_t ) {
+         ++current.inline_actions;
+      });
+      intrinsics::set_intrinsic<intrinsics::send_inline>( [&]( char* data, size_t len ) {
+         inline_queue.emplace_back( data, data + len );
+      });
+      intrinsics::set_intrinsic<intrinsics::send_deferred>( [&]( auto&&... ) {
+         ++current.inline_actions;
+      });
+      intrinsics::set_intrinsic<intrinsics::cancel_deferred>( []( auto&&... ) { return 0; } );
+      intrinsics::set_intrinsic<intrinsics::eosio_assert>( []( uint32_t test, const char* msg ) {
+         if( !test )
+            fail( msg, std::strlen( msg ) );
+      });
+      intrinsics::set_intrinsic<intrinsics::eosio_assert_message>( []( uint32_t test, const char* msg, uint32_t len ) {
+         if( !test )
+            fail( msg, len );
+      });
+      intrinsics::set_intrinsic<intrinsics::eosio_assert_code>( []( uint32_t test, uint64_t code ) {
+         if( !test ) {
+            const std::string msg = "error code " + std::to_string( code );
+            fail( msg.data(), msg.size() );
+         }
+      });
+
+      // block, producers and resources
+      intrinsics::set_intrinsic<intrinsics::get_blockchain_parameters_packed>( []( char* data, uint32_t len ) {
+         // the system contract only copies them into its globals
+         const auto packed = eosio::pack( eosio::blockchain_parameters{} );
+         std::memcpy( data, packed.data(), std::min<size_t>( len, packed.size() ) );
+         return uint32_t(packed.size());
+      });
+      intrinsics::set_intrinsic<intrinsics::current_time>( [&]() {
+         return genesis_us + uint64_t(head_block) * 500000;
+      });
+      intrinsics::set_intrinsic<intrinsics::get_chain_head_num>( [&]() {
+         return head_block;
+      });
+      intrinsics::set_intrinsic<intrinsics::forest_period_number>( [&]() {
+         return forest_period;
+      });
+      intrinsics::set_intrinsic<intrinsics::forest_space_number>( [&]() {
+         return forest_space;
+      });
+      intrinsics::set_intrinsic<intrinsics::set_proposed_producers>( [&]( char* data, uint32_t len ) {
+         // the proposed schedule becomes active at once, the harness does not run irreversibility
+         const auto schedule = eosio::unpack<std::vector<eosio::producer_key>>( data, len );
+         active_producers.clear();
+         for( const auto& p : schedule )
+            active_producers.push_back( p.producer_name );
+         return int64_t(++schedule_version);
+      });
+      intrinsics::set_intrinsic<intrinsics::get_active_producers>( [&]( uint64_t* producers, uint32_t len ) {
+         const uint32_t count = std::min<uint32_t>( len / sizeof(uint64_t), active_producers.size() );
+         for( uint32_t i = 0; i < count; ++i )
+            producers[i] = active_producers[i].value;
+         return uint32_t(active_producers.size() * sizeof(uint64_t));
+      });
+      intrinsics::set_intrinsic<intrinsics::set_resource_limits>( [&]( uint64_t account, int64_t ram, int64_t net, int64_t cpu ) {
+         resource_limits[account] = {ram, net, cpu};
+      });
+      intrinsics::set_intrinsic<intrinsics::get_resource_limits>( [&]( uint64_t account, int64_t* ram, int64_t* net, int64_t* cpu ) {
+         const auto& limits = resource_limits[account];
+         *ram = limits[0];
+         *net = limits[1];
+         *cpu = limits[2];
+      });
+
+      // celesos: every wood is valid, no RAM decays and no resource weight is unpaid
+      intrinsics::set_intrinsic<intrinsics::verify_wood>( []( auto&&... ) { return true; } );
+      intrinsics::set_intrinsic<intrinsics::set_difficulty>( []( auto&&... ) {} );
+      intrinsics::set_intrinsic<intrinsics::ram_attenuation>( []( auto&&... ) { return 0; } );
+      intrinsics::set_intrinsic<intrinsics::get_need_attenuation_account>( []( auto&&... ) { return 0; } );
+      intrinsics::set_intrinsic<intrinsics::setclaimed>( []( auto&&... ) {} );
+      intrinsics::set_intrinsic<intrinsics::total_unpaid_resouresweight>( []( auto&&... ) { return 0; } );
+      intrinsics::set_intrinsic<intrinsics::unpaid_resouresweight>( []( auto&&... ) { return 0; } );
+   }
+
+   #undef CELESOS_SECONDARY_INTRINSICS
+
+} /// namespace celesostest
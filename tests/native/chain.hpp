@@ -0,0 +1,187 @@
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace celesostest {
+
+   /// what one pushed action cost, its inline token actions included
+   struct usage {
+      uint64_t rows_read      = 0; ///< primary rows deserialized by `db_get_i64`
+      uint64_t rows_written   = 0; ///< primary rows stored, updated or removed
+      uint64_t index_ops      = 0; ///< secondary index lookups, steps and writes
+      uint64_t bytes_read     = 0;
+      uint64_t bytes_written  = 0;
+      uint64_t inline_actions = 0; ///< inline and deferred actions sent, notifications included
+
+      usage& operator+=( const usage& u );
+   };
+
+   /**
+    * In-memory stand-in for the chain a natively built contract runs against.
+    *
+    * @details `install()` routes the intrinsics the system contract calls to this object: the
+    * `db_*` tables and their secondary indexes, the block and forest numbers, `verify_wood`, the
+    * producer schedule, resource limits and inline actions. Inline `celes.token` transfers move
+    * balances in the token's `accounts` rows once the action returns, as the chain would run them;
+    * other inline actions are only counted. Authorization checks always pass and `verify_wood`
+    * accepts every wood, the harness measures the contract, not the chain.
+    */
+   class chain {
+      public:
+         static chain& get();
+
+         /// routes the intrinsics to this chain, call once before running any contract code
+         void install();
+
+         /// starts a block, `current_time` advances half a second per block
+         void set_head( uint32_t block_number );
+         uint32_t head()const { return head_block; }
+
+         uint32_t forest_period = 600; ///< blocks of wood history kept
+         uint32_t forest_space  = 60;  ///< blocks sharing one difficulty
+
+         /// runs `f` as `receiver`, then the inline actions it sent, and returns what they cost
+         template<typename F>
+         usage apply( eosio::name receiver, F&& f ) {
+            begin_action( receiver );
+            f();
+            run_inline_actions();
+            return current;
+         }
+
+         /// creates the token `supply` held by nobody yet
+         void create_token( const eosio::asset& supply );
+         /// credits `owner`, the harness's stand-in for an issue
+         void issue( eosio::name owner, const eosio::asset& quantity );
+         eosio::asset balance( eosio::name owner, const eosio::symbol& sym );
+
+         uint32_t schedule_version = 0;
+         std::vector<eosio::name> active_producers;
+
+      private:
+         struct table_id {
+            uint64_t code;
+            uint64_t scope;
+            uint64_t table;
+
+            bool operator<( const table_id& t )const {
+               return std::tie( code, scope, table ) < std::tie( t.code, t.scope, t.table );
+            }
+         };
+
+         using table = std::map<uint64_t, std::vector<char>>;
+
+         /// iterators of one action, the end iterator of table `i` is `-(i + 2)`
+         template<typename Table>
+         struct iterator_cache {
+            std::vector<std::pair<Table*, uint64_t>> rows;
+            std::vector<Table*>                      ends;
+
+            int32_t row( Table* t, uint64_t primary ) {
+               rows.emplace_back( t, primary );
+               return int32_t(rows.size() - 1);
+            }
+
+            int32_t end( Table* t ) {
+               for( size_t i = 0; i < ends.size(); ++i )
+                  if( ends[i] == t )
+                     return -int32_t(i + 2);
+               ends.push_back( t );
+               return -int32_t(ends.size() + 1);
+            }
+
+            Table* end_table( int32_t itr )const { return itr < -1 ? ends[-itr - 2] : nullptr; }
+
+            void clear() {
+               rows.clear();
+               ends.clear();
+            }
+         };
+
+         /// one secondary index type, the rows are ordered by secondary key then primary key
+         template<typename Key>
+         class secondary_index {
+            public:
+               struct sec_table {
+                  std::map<uint64_t, Key>            by_primary;
+                  std::set<std::pair<Key, uint64_t>> ordered;
+               };
+
+               explicit secondary_index( chain& c ):_chain(c) {}
+
+               int32_t store( uint64_t scope, uint64_t table, uint64_t id, const Key& secondary );
+               void update( int32_t itr, const Key& secondary );
+               void remove( int32_t itr );
+               int32_t next( int32_t itr, uint64_t* primary );
+               int32_t previous( int32_t itr, uint64_t* primary );
+               int32_t find_primary( uint64_t code, uint64_t scope, uint64_t table, Key& secondary, uint64_t primary );
+               int32_t find_secondary( uint64_t code, uint64_t scope, uint64_t table, const Key& secondary, uint64_t* primary );
+               int32_t lowerbound( uint64_t code, uint64_t scope, uint64_t table, Key& secondary, uint64_t* primary );
+               int32_t upperbound( uint64_t code, uint64_t scope, uint64_t table, Key& secondary, uint64_t* primary );
+               int32_t end( uint64_t code, uint64_t scope, uint64_t table );
+
+               void clear_iterators() { _iterators.clear(); }
+
+            private:
+               int32_t at( sec_table& t, typename std::set<std::pair<Key, uint64_t>>::iterator it,
+                           Key* secondary, uint64_t* primary );
+
+               chain&                            _chain;
+               std::map<table_id, sec_table>     _tables;
+               iterator_cache<sec_table>         _iterators;
+         };
+
+         chain();
+
+         void begin_action( eosio::name receiver );
+         void switch_receiver( eosio::name receiver );
+         void run_inline_actions();
+         void apply_token_action( const eosio::action& act );
+         void transfer( eosio::name from, eosio::name to, const eosio::asset& quantity );
+
+         table& find_table( uint64_t code, uint64_t scope, uint64_t table_name );
+
+         // primary tables
+         int32_t db_store( uint64_t scope, uint64_t table_name, uint64_t id, const void* data, uint32_t len );
+         void db_update( int32_t itr, const void* data, uint32_t len );
+         void db_remove( int32_t itr );
+         int32_t db_get( int32_t itr, void* data, uint32_t len );
+         int32_t db_next( int32_t itr, uint64_t* primary );
+         int32_t db_previous( int32_t itr, uint64_t* primary );
+         int32_t db_find( uint64_t code, uint64_t scope, uint64_t table_name, uint64_t id );
+         int32_t db_lowerbound( uint64_t code, uint64_t scope, uint64_t table_name, uint64_t id );
+         int32_t db_upperbound( uint64_t code, uint64_t scope, uint64_t table_name, uint64_t id );
+         int32_t db_end( uint64_t code, uint64_t scope, uint64_t table_name );
+
+         eosio::name                           receiver;
+         uint32_t                              head_block = 0;
+         usage                                 current;
+         std::vector<std::vector<char>>        inline_queue;
+         std::map<table_id, table>             tables;
+         iterator_cache<table>                 iterators;
+         std::map<uint64_t, std::array<int64_t, 3>> resource_limits;
+
+         secondary_index<uint64_t>                  idx64;
+         secondary_index<uint128_t>                 idx128;
+         secondary_index<std::array<uint128_t, 2>>  idx256;
+         secondary_index<double>                    idx_double;
+   };
+
+   /// packs `args` as the data of an action, so the contract can read it from its datastream
+   template<typename... Args>
+   std::vector<char> action_data( const Args&... args ) {
+      return eosio::pack( std::make_tuple( args... ) );
+   }
+
+} /// namespace celesostest
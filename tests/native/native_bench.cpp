@@ -0,0 +1,275 @@
+/**
+ * Replays synthetic workloads against the system contract built natively over the in-memory
+ * chain of chain.hpp, and reports per action the rows it touched, the bytes it serialized and
+ * its wall time.
+ *
+ * native_bench [voters] [woods_per_block] [rex_loans] [blocks] [producers]
+ * native_bench --smoke
+ */
+#include "chain.hpp"
+
+#include <celesos.system/celesos.system.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using celesossystem::system_contract;
+using celesostest::action_data;
+using celesostest::chain;
+using celesostest::usage;
+
+namespace {
+
+   constexpr eosio::name system_account{"celes"_n};
+   constexpr eosio::symbol core_symbol{"CELES", 4};
+
+   struct workload {
+      uint32_t voters          = 200;
+      uint32_t woods_per_block = 100;
+      uint32_t rex_loans       = 50;
+      uint32_t blocks          = 720;
+      uint32_t producers       = 21;
+   };
+
+   struct action_stats {
+      uint64_t calls      = 0;
+      uint64_t data_bytes = 0;
+      usage    total;
+      double   wall_us    = 0;
+      double   max_us     = 0;
+   };
+
+   std::map<std::string, action_stats> stats;
+
+   /**
+    * Pushes one action: constructs the contract over `data` as the chain would, calls `f` on it and
+    * runs the inline actions it sent. The wall time covers the contract, from loading its globals
+    * to writing them back, and not the stand-in token transfers.
+    */
+   template<typename F>
+   void run( const char* action, const std::vector<char>& data, F&& f ) {
+      double us = 0;
+      const usage u = chain::get().apply( system_account, [&] {
+         const auto start = std::chrono::steady_clock::now();
+         {
+            system_contract contract( system_account, system_account,
+                                      eosio::datastream<const char*>( data.data(), data.size() ) );
+            f( contract );
+         }
+         us = std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count();
+      });
+
+      auto& s = stats[action];
+      ++s.calls;
+      s.data_bytes += data.size();
+      s.total      += u;
+      s.wall_us    += us;
+      s.max_us      = std::max( s.max_us, us );
+   }
+
+   /// `prefix` followed by `i` in base 31, a valid account name for any `i` below 31^(12 - prefix length)
+   eosio::name account( const char* prefix, uint32_t i ) {
+      static const char digits[] = "12345abcdefghijklmnopqrstuvwxyz";
+      std::string s( prefix );
+      do {
+         s += digits[i % 31];
+         i /= 31;
+      } while( i > 0 );
+      return eosio::name( s );
+   }
+
+   eosio::public_key producer_key( uint32_t i ) {
+      eosio::ecc_public_key key{};
+      key[0] = 2;
+      std::memcpy( key.data() + 1, &i, sizeof(i) );
+      return eosio::public_key( std::in_place_index<0>, key );
+   }
+
+   /// a wood no other submission uses, the stand-in accepts every wood
+   std::string next_wood() {
+      static uint64_t counter = 0;
+      char hex[65];
+      std::snprintf( hex, sizeof(hex), "%064llx", (unsigned long long)++counter );
+      return hex;
+   }
+
+   void start_block( uint32_t block_number, eosio::name producer ) {
+      chain::get().set_head( block_number );
+      const eosio::block_timestamp timestamp( eosio::current_time_point() );
+      run( "onblock", action_data( timestamp, producer ), [&]( system_contract& c ) {
+         c.onblock( eosio::ignore<celesossystem::block_header>{} );
+      });
+   }
+
+   void setup( const workload& w, std::vector<eosio::name>& producers ) {
+      auto& c = chain::get();
+      c.create_token( eosio::asset( 10'000'000'000'0000ll, core_symbol ) );
+      for( auto pool : { system_contract::bpaypool_account, system_contract::wpaypool_account,
+                         system_contract::dpaypool_account } )
+         c.issue( pool, eosio::asset( 100'000'000'0000ll, core_symbol ) );
+      // the pay accounts are read before anything is paid to them
+      for( auto pay : { system_contract::bpay_account, system_contract::wpay_account, system_contract::dpay_account } )
+         c.issue( pay, eosio::asset( 0, core_symbol ) );
+
+      run( "init", action_data( eosio::unsigned_int( 0 ), core_symbol ), [&]( system_contract& s ) {
+         s.init( eosio::unsigned_int( 0 ), core_symbol );
+      });
+
+      for( uint32_t i = 0; i < w.producers; ++i ) {
+         const eosio::name p = account( "producer", i );
+         const auto key = producer_key( i );
+         run( "regproducer", action_data( p, key, std::string(), uint16_t(0) ), [&]( system_contract& s ) {
+            s.regproducer( p, key, std::string(), 0 );
+         });
+         producers.push_back( p );
+      }
+
+      // leaves the election nothing to wait for
+      run( "migrateprods", action_data( w.producers ), [&]( system_contract& s ) {
+         s.migrateprods( w.producers );
+      });
+   }
+
+   /// one lender buys REX, then `rex_loans` renters each rent CPU from it
+   void rent_rex( const workload& w ) {
+      if( w.rex_loans == 0 )
+         return;
+
+      auto& c = chain::get();
+      const eosio::name lender = account( "lender", 0 );
+      const eosio::asset lent( 1'000'000'0000ll, core_symbol );
+      const eosio::asset payment( 1'0000, core_symbol );
+      const eosio::asset no_fund( 0, core_symbol );
+
+      // buyrex requires a vote, a proxy is the cheapest one to seed
+      c.apply( system_account, [&] {
+         celesossystem::voters_table voters( system_account, system_account.value );
+         voters.emplace( system_account, [&]( auto& v ) {
+            v.owner = lender;
+            v.proxy = account( "proxy", 0 );
+         });
+      });
+
+      c.issue( lender, lent );
+      run( "deposit", action_data( lender, lent ), [&]( system_contract& s ) {
+         s.deposit( lender, lent );
+      });
+      run( "buyrex", action_data( lender, lent ), [&]( system_contract& s ) {
+         s.buyrex( lender, lent );
+      });
+
+      for( uint32_t i = 0; i < w.rex_loans; ++i ) {
+         const eosio::name renter = account( "renter", i );
+         c.issue( renter, payment );
+         run( "deposit", action_data( renter, payment ), [&]( system_contract& s ) {
+            s.deposit( renter, payment );
+         });
+         run( "rentcpu", action_data( renter, renter, payment, no_fund ), [&]( system_contract& s ) {
+            s.rentcpu( renter, renter, payment, no_fund );
+         });
+      }
+   }
+
+   /**
+    * Each block starts with onblock, then `woods_per_block` woods mined for the previous block are
+    * submitted, handed to the voters in turn, one votewoods per voter with woods in the block.
+    */
+   void vote_woods( const workload& w, const std::vector<eosio::name>& producers, uint32_t first_block ) {
+      uint64_t submitted = 0;
+      for( uint32_t b = 0; b < w.blocks; ++b ) {
+         const uint32_t head = first_block + b;
+         start_block( head, producers[b % producers.size()] );
+
+         std::map<uint32_t, std::vector<celesossystem::wood_submission>> by_voter;
+         for( uint32_t i = 0; i < w.woods_per_block; ++i, ++submitted )
+            by_voter[submitted % w.voters].push_back( celesossystem::wood_submission{ next_wood(), head - 1 } );
+
+         for( const auto& [v, woods] : by_voter ) {
+            const eosio::name voter = account( "voter", v );
+            const eosio::name producer = producers[v % producers.size()];
+            run( "votewoods", action_data( voter, eosio::name(), woods, producer ), [&]( system_contract& s ) {
+               s.votewoods( voter, eosio::name(), woods, producer );
+            });
+         }
+      }
+   }
+
+   /**
+    * Moves the chain 30 days on, past the claim period of the producers and the term of the loans,
+    * then claims the producers' rewards and settles the expired loans.
+    */
+   void settle( const workload& w, const std::vector<eosio::name>& producers ) {
+      const uint32_t head = chain::get().head() + 30 * celesossystem::blocks_per_day + 1;
+      start_block( head, producers.front() );
+
+      for( const auto& p : producers ) {
+         run( "claimrewards", action_data( p ), [&]( system_contract& s ) {
+            s.claimrewards( p );
+         });
+      }
+
+      if( w.rex_loans == 0 )
+         return;
+
+      const eosio::name lender = account( "lender", 0 );
+      const uint16_t max = uint16_t( std::min<uint32_t>( w.rex_loans, 65535 ) );
+      run( "rexexec", action_data( lender, max ), [&]( system_contract& s ) {
+         s.rexexec( lender, max );
+      });
+   }
+
+   void report( const workload& w ) {
+      std::printf( "voters %u, woods per block %u, rex loans %u, blocks %u, producers %u\n\n",
+                   w.voters, w.woods_per_block, w.rex_loans, w.blocks, w.producers );
+      std::printf( "%-14s %8s %10s %10s %10s %10s %10s %10s %8s %10s %10s\n", "action", "calls", "data B",
+                   "rows read", "rows wrtn", "index ops", "bytes read", "bytes wrtn", "inline", "wall us", "max us" );
+
+      // averages per call
+      for( const auto& [name, s] : stats ) {
+         const double n = double(s.calls);
+         std::printf( "%-14s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %8.1f %10.2f %10.2f\n", name.c_str(),
+                      (unsigned long long)s.calls, s.data_bytes / n, s.total.rows_read / n, s.total.rows_written / n,
+                      s.total.index_ops / n, s.total.bytes_read / n, s.total.bytes_written / n,
+                      s.total.inline_actions / n, s.wall_us / n, s.max_us );
+      }
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   workload w;
+   if( argc > 1 && std::strcmp( argv[1], "--smoke" ) == 0 ) {
+      w = workload{ 8, 16, 2, 40, BP_COUNT };
+   } else {
+      uint32_t* fields[] = { &w.voters, &w.woods_per_block, &w.rex_loans, &w.blocks, &w.producers };
+      for( int i = 1; i < argc && i <= 5; ++i )
+         *fields[i - 1] = uint32_t( std::strtoul( argv[i], nullptr, 10 ) );
+   }
+
+   if( w.voters == 0 || w.producers == 0 ) {
+      std::fprintf( stderr, "usage: %s [voters] [woods_per_block] [rex_loans] [blocks] [producers] | --smoke\n", argv[0] );
+      return 1;
+   }
+
+   auto& c = chain::get();
+   c.install();
+
+   // the first election is due on the second block, after one block of woods
+   const uint32_t first_block = SINGING_TICKER_SEP - 1;
+   c.set_head( first_block - 1 );
+
+   std::vector<eosio::name> producers;
+   setup( w, producers );
+   rent_rex( w );
+   vote_woods( w, producers, first_block );
+   settle( w, producers );
+
+   report( w );
+   return 0;
+}
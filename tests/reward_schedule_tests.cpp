@@ -0,0 +1,122 @@
+#include <host_test.hpp>
+
+#include <celesos.system/reward_schedule.hpp>
+
+#include <cmath>
+#include <random>
+
+using namespace celesossystem;
+using namespace celesostest;
+
+// copied from celesos.system.hpp and poolcontract.cpp, which need the eosio headers
+static constexpr uint64_t dpay_pool_full = uint64_t(21 * 10000 * 10000) * 3000;
+static constexpr uint64_t bpay_pool_full = uint64_t(21 * 10000 * 10000) * 1500;
+static constexpr uint64_t wpay_pool_full = uint64_t(21 * 10000 * 10000) * 1500;
+static constexpr int64_t  origin_reward  = 5000;
+static constexpr int      all_reward       = 10000000;
+static constexpr int      half_lift_period = 8000000;
+
+/// halving tier as onblock computed it before reward_schedule, defined for `balance <= full`
+static uint32_t legacy_tier( uint64_t full, int64_t balance ) {
+   return static_cast<uint32_t>( log( full / balance ) / log( 2 ) );
+}
+
+/// per block payout as onblock computed it before reward_schedule
+static int64_t legacy_amount( uint64_t full, int64_t origin, int64_t balance ) {
+   const uint32_t halftime = legacy_tier( full, balance );
+   return std::max( int64_t(1), static_cast<int64_t>( origin * pow( 0.5, halftime ) ) );
+}
+
+/// `calculate_reward` increment of poolcontract before reward_schedule
+static uint64_t legacy_pool_reward( int64_t unreceived, uint32_t blocks ) {
+   int half_life_period = (int)( log( all_reward / unreceived ) / log( 2 ) );
+   return (uint64_t)( (all_reward / 2 / half_lift_period) * blocks * pow( 0.5, half_life_period ) );
+}
+
+static uint64_t pool_reward( int64_t unreceived, uint32_t blocks ) {
+   uint32_t half_life_period = halving_tier( all_reward, unreceived );
+   return (uint64_t)( (all_reward / 2 / half_lift_period) * blocks ) >> half_life_period;
+}
+
+template<uint64_t Full>
+static void check_pool( std::mt19937_64& rng, uint64_t random_balances ) {
+   using schedule = reward_schedule<Full, origin_reward>;
+   uint64_t mismatches = 0;
+   auto compare = [&]( int64_t balance ) {
+      if( balance < 1 || uint64_t(balance) > Full )
+         return;
+      if( schedule::amount( balance ) != legacy_amount( Full, origin_reward, balance ) ) {
+         if( mismatches++ < 5 )
+            std::fprintf( stderr, "pool %llu: balance %lld pays %lld instead of %lld\n",
+                          (unsigned long long)Full, (long long)balance,
+                          (long long)schedule::amount( balance ), (long long)legacy_amount( Full, origin_reward, balance ) );
+      }
+   };
+
+   // every tier boundary, the balance where full / balance reaches the next power of two
+   for( uint32_t tier = 0; tier < schedule::tiers; ++tier ) {
+      const int64_t boundary = int64_t( Full >> tier );
+      for( int64_t delta = -3; delta <= 3; ++delta )
+         compare( boundary + delta );
+      const int64_t next = int64_t( Full / ((uint64_t(1) << tier) + 1) );
+      for( int64_t delta = -3; delta <= 3; ++delta )
+         compare( next + delta );
+   }
+
+   // the tail of the pool, where every tier is only a few balances wide
+   for( int64_t balance = 1; balance <= 1000000; ++balance )
+      compare( balance );
+
+   std::uniform_int_distribution<uint64_t> anywhere( 1, Full );
+   for( uint64_t i = 0; i < random_balances; ++i )
+      compare( int64_t(anywhere( rng )) );
+
+   HOST_CHECK( mismatches == 0 );
+}
+
+int main() {
+   std::mt19937_64 rng( 20190501 );
+
+   check_pool<bpay_pool_full>( rng, 2000000 );
+   check_pool<wpay_pool_full>( rng, 2000000 );
+   check_pool<dpay_pool_full>( rng, 2000000 );
+
+   // poolcontract pays from a pool of all_reward, every unreceived balance is checked
+   uint64_t pool_mismatches = 0;
+   for( int64_t unreceived = 1; unreceived <= all_reward; ++unreceived ) {
+      if( halving_tier( all_reward, unreceived ) != legacy_tier( all_reward, unreceived ) )
+         ++pool_mismatches;
+      for( uint32_t blocks : { 1u, 7u, 1000u } ) {
+         if( pool_reward( unreceived, blocks ) != legacy_pool_reward( unreceived, blocks ) )
+            ++pool_mismatches;
+      }
+   }
+   HOST_CHECK( pool_mismatches == 0 );
+
+   // reward_schedule accepts Full below 2^47: up to there the tier equals floor(log(q) / log(2))
+   // around every power of two q, past it the double expression starts to round up
+   for( uint32_t bit = 1; bit < 47; ++bit ) {
+      const uint64_t power = uint64_t(1) << bit;
+      for( uint64_t quotient = power - 1; quotient <= power + 1; ++quotient )
+         HOST_CHECK( halving_tier( quotient, 1 ) == legacy_tier( quotient, 1 ) );
+   }
+   HOST_CHECK( halving_tier( (uint64_t(1) << 47) - 1, 1 ) == legacy_tier( (uint64_t(1) << 47) - 1, 1 ) );
+   HOST_CHECK( (reward_schedule<(uint64_t(1) << 47) - 1, origin_reward>::amount( 1 ) == 1) );
+
+   for( uint32_t bit = 47; bit < 64; ++bit ) {
+      const uint64_t quotient = (uint64_t(1) << bit) - 1;
+      if( halving_tier( quotient, 1 ) != legacy_tier( quotient, 1 ) ) {
+         std::printf( "first tier mismatch at 2^%u - 1\n", bit );
+         break;
+      }
+   }
+
+   report( "reward_schedule::amount", ns_per_call( 10000000, []( uint64_t i ) {
+      return reward_schedule<bpay_pool_full, origin_reward>::amount( int64_t(i % bpay_pool_full + 1) );
+   }));
+   report( "legacy log/pow amount", ns_per_call( 10000000, []( uint64_t i ) {
+      return legacy_amount( bpay_pool_full, origin_reward, int64_t(i % bpay_pool_full + 1) );
+   }));
+
+   return result();
+}
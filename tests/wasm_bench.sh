@@ -0,0 +1,30 @@
+#! /bin/bash
+# CPU billed by a local node for the Bancor conversions in WASM, fixed-point kernel against doubles.
+#
+# Needs a running node with celesos.test deployed on ACCOUNT, whose active key is in the wallet:
+#    tests/wasm_bench.sh [account] [iterations] [runs]
+# The cost of a conversion pair is the median CPU of `benchbancor` less that of an empty run, over
+# the iterations. CLEOS may point at a cleos with its -u option.
+
+ACCOUNT=${1:-celesos.test}
+ITERATIONS=${2:-1000}
+RUNS=${3:-11}
+CLEOS=${CLEOS:-cleos}
+
+# median cpu_usage_us of RUNS pushes of benchbancor [iterations, legacy]
+billed() {
+   for (( run = 0; run < RUNS; ++run )); do
+      ${CLEOS} push action -f -j ${ACCOUNT} benchbancor "[$1, $2]" -p ${ACCOUNT}@active \
+         | grep -o '"cpu_usage_us": [0-9]*' | head -n 1 | grep -o '[0-9]*$'
+   done | sort -n | awk '{ v[NR] = $1 } END { if (NR == 0) exit 1; print v[int((NR + 1) / 2)] }'
+}
+
+EMPTY=$(billed 0 false) || { echo "benchbancor could not be pushed to ${ACCOUNT}" >&2; exit 1; }
+KERNEL=$(billed ${ITERATIONS} false) || exit 1
+LEGACY=$(billed ${ITERATIONS} true) || exit 1
+
+printf "%-40s %10s us\n" "empty action" ${EMPTY}
+awk -v e=${EMPTY} -v k=${KERNEL} -v l=${LEGACY} -v n=${ITERATIONS} 'BEGIN {
+   printf "%-40s %10.1f ns/pair\n", "bancor::issue + bancor::redeem", (k - e) * 1000 / n
+   printf "%-40s %10.1f ns/pair\n", "legacy issue + redeem", (l - e) * 1000 / n
+}'